@@ -5,4 +5,3 @@
 #include "CoreMinimal.h"
 
 #define ECC_SkeletalMesh ECollisionChannel::ECC_GameTraceChannel1
-#define ECC_HitBox ECollisionChannel::ECC_GameTraceChannel2
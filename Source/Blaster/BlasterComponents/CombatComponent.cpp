@@ -16,6 +16,10 @@
 #include "Blaster/Character/BlasterAnimInstance.h"
 #include "Blaster/Weapon/Projectile.h"
 #include "Blaster/Weapon/Shotgun.h"
+#include "Blaster/Weapon/ShotNet.h"
+#include "Blaster/Weapon/ShotEventSubsystem.h"
+#include "Blaster/LagCompensation/NetTime.h"
+#include "Blaster/PlayerState/BlasterPlayerState.h"
 
 UCombatComponent::UCombatComponent() {
 	// Set this component to be initialized when the game starts, and to be ticked every frame.  You can turn these features
@@ -36,6 +40,8 @@ void UCombatComponent::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& Out
 	DOREPLIFETIME(UCombatComponent, CombatState);
 	DOREPLIFETIME(UCombatComponent, Grenades);
 	DOREPLIFETIME(UCombatComponent, bHoldingTheFlag);
+	DOREPLIFETIME(UCombatComponent, ScatterSeed);
+	DOREPLIFETIME_CONDITION(UCombatComponent, LastServerShotSequence, COND_OwnerOnly);
 }
 
 void UCombatComponent::BeginPlay() {
@@ -49,6 +55,7 @@ void UCombatComponent::BeginPlay() {
 		}
 		if (Character->HasAuthority()) {
 			InitializeCarriedAmmo();
+			ScatterSeed = FMath::Rand();
 		}
 	}
 }
@@ -64,6 +71,14 @@ void UCombatComponent::TickComponent(float DeltaTime, ELevelTick TickType,
 
 		SetHUDCrosshairs(DeltaTime);
 		InterpFOV(DeltaTime);
+		UpdateFireSchedule();
+
+		if (!PendingFireInputs.IsEmpty()) {
+			FireInputResendTime += DeltaTime;
+			if (FireInputResendTime >= FireInputResendInterval) {
+				SendFireInputs();
+			}
+		}
 	}
 }
 
@@ -237,7 +252,10 @@ bool UCombatComponent::CanFire() {
 	if (EquippedWeapon == nullptr) {
 		return false;
 	}
-	
+
+	// Every shot has to reach the server, so wait for acknowledgements
+	if (IsFireInputBacklogFull()) return false;
+
 	if (!EquippedWeapon->IsEmpty() &&
 		bCanFire &&
 		CombatState == ECombatState::ECS_Reloading &&
@@ -250,142 +268,315 @@ bool UCombatComponent::CanFire() {
 
 void UCombatComponent::Fire() {
 	if (CanFire()) {
-		bCanFire = false;
-
-		if (EquippedWeapon) {
-			CrosshairShootingFactor = 1.f;
-			switch (EquippedWeapon->FireType) {
-			case EFireType::EFT_Projectile:
-				FireProjectileWeapon();
-				break;
-			case EFireType::EFT_HitScan:
-				FireHitScanWeapon();
-				break;
-			case EFireType::EFT_Shotgun:
-				FireShotgun();
-				break;
-			}
-		}
-		StartFireTimer();
+		FireAt(GetWorld()->GetTimeSeconds());
+		SendFireInputs();
 	}
 }
 
-void UCombatComponent::FireProjectileWeapon() {
-	if (EquippedWeapon && Character) {
-		HitTarget = EquippedWeapon->bUseScatter ? EquippedWeapon->TraceEndWithScatter(HitTarget) : HitTarget;
+/**
+* Fires one shot stamped with ShotTime, which can be earlier in the frame than
+* now. Doesn't send it, so several shots can go to the server in one packet.
+*/
+void UCombatComponent::FireAt(double ShotTime) {
+	if (EquippedWeapon == nullptr) return;
+
+	bCanFire = false;
+	NextFireTime = ShotTime + EquippedWeapon->FireDelay;
+	CrosshairShootingFactor = 1.f;
+	switch (EquippedWeapon->FireType) {
+	case EFireType::EFT_Projectile:
+		FireProjectileWeapon(ShotTime);
+		break;
+	case EFireType::EFT_HitScan:
+		FireHitScanWeapon(ShotTime);
+		break;
+	case EFireType::EFT_Shotgun:
+		FireShotgun(ShotTime);
+		break;
+	}
+}
+
+void UCombatComponent::FireProjectileWeapon(double ShotTime) {
+	FVector MuzzleLocation;
+	if (EquippedWeapon && Character && EquippedWeapon->GetMuzzleLocation(MuzzleLocation)) {
+		FFireInput Input;
+		Input.Aim = ShotNet::CompressAim(HitTarget - MuzzleLocation);
+		Input.Sequence = ++ShotSequence;
+		Input.Time = GetShotNetTime(ShotTime);
 		if (!Character->HasAuthority()) {
-			LocalFire(HitTarget);
+			LocalFire(Input.Aim, Input.Sequence);
 		}
-		ServerFire(HitTarget, EquippedWeapon->FireDelay);
+		QueueFireInput(Input);
 	}
 }
 
-void UCombatComponent::FireHitScanWeapon() {
-	if (EquippedWeapon && Character) {
-		HitTarget = EquippedWeapon->bUseScatter ? EquippedWeapon->TraceEndWithScatter(HitTarget) : HitTarget;
+void UCombatComponent::FireHitScanWeapon(double ShotTime) {
+	FVector MuzzleLocation;
+	if (EquippedWeapon && Character && EquippedWeapon->GetMuzzleLocation(MuzzleLocation)) {
+		FFireInput Input;
+		Input.Aim = ShotNet::CompressAim(HitTarget - MuzzleLocation);
+		Input.Sequence = ++ShotSequence;
+		Input.Time = GetShotNetTime(ShotTime);
 		if (!Character->HasAuthority()) {
-			LocalFire(HitTarget);
+			LocalFire(Input.Aim, Input.Sequence);
 		}
-		ServerFire(HitTarget, EquippedWeapon->FireDelay);
+		QueueFireInput(Input);
 	}
 }
 
-void UCombatComponent::FireShotgun() {
+/**
+* Only the muzzle, aim and sequence number are sent. The muzzle is rounded the
+* way it will arrive, so the pellets generated here match the ones the server
+* and other clients generate.
+*/
+void UCombatComponent::FireShotgun(double ShotTime) {
 	AShotgun* Shotgun = Cast<AShotgun>(EquippedWeapon);
-	if (Shotgun && Character) {
-		TArray<FVector_NetQuantize> HitTargets;
-		Shotgun->ShotgunTraceEndWithScatter(HitTarget, HitTargets);
+	FVector_NetQuantize TraceStart;
+	if (Shotgun && Character && Shotgun->GetTraceStart(TraceStart)) {
+		FFireInput Input;
+		Input.TraceStart = TraceStart;
+		Input.Aim = ShotNet::CompressAim(HitTarget - TraceStart);
+		Input.Sequence = ++ShotSequence;
+		Input.Time = GetShotNetTime(ShotTime);
+		Input.bShotgun = true;
+
+		// The score request can reach the server before the blast's own fire
+		// input, in which case the server fires the blast from the request
+		QueueFireInput(Input);
 		if (!Character->HasAuthority()) {
-			LocalShotgunFire(HitTargets);
+			LocalShotgunFire(Input);
 		}
-		ServerShotgunFire(HitTargets, EquippedWeapon->FireDelay);
 	}
 }
 
 /**
 * One advantage of a fire delay is so a character can't spam the fire button faster
 * than the automatic fire rate.
+*
+* A timer per shot could only run out on a frame boundary, losing up to a frame
+* every shot, so automatic weapons fired slower at low frame rates. Instead each
+* frame fires every shot that came due since the last, at the time it was due,
+* and sends them to the server together. After a long hitch, or while the
+* server is behind on acknowledging shots, the rest are fired from now on
+* later frames instead.
 */
-void UCombatComponent::StartFireTimer() {
-	if (EquippedWeapon == nullptr || Character == nullptr) return;
-
-	UE_LOG(LogTemp, Warning, TEXT("fire timer"));
-	Character->GetWorldTimerManager().SetTimer(FireTimer,
-		this,
-		&UCombatComponent::FireTimerFinished,
-		EquippedWeapon->FireDelay);
+void UCombatComponent::UpdateFireSchedule() {
+	if (bCanFire || EquippedWeapon == nullptr) return;
+
+	const double Now = GetWorld()->GetTimeSeconds();
+	int32 NumShots = 0;
+	while (!bCanFire && NextFireTime <= Now) {
+		bCanFire = true;
+		if (!bFireButtonPressed || !EquippedWeapon->bAutomatic) break;
+
+		if (NumShots == MAX_FIRE_INPUTS || IsFireInputBacklogFull()) {
+			bCanFire = false;
+			NextFireTime = Now;
+			break;
+		}
+		if (CanFire()) {
+			FireAt(NextFireTime);
+			NumShots++;
+		}
+	}
+	if (NumShots > 0) {
+		SendFireInputs();
+	}
+	if (bCanFire) {
+		ReloadEmptyWeapon();
+	}
 }
 
-void UCombatComponent::FireTimerFinished() {
-	if (EquippedWeapon == nullptr) return;
+uint16 UCombatComponent::GetShotNetTime(double ShotTime) {
+	const double Now = GetWorld()->GetTimeSeconds();
+	Controller = Controller == nullptr ? Cast<ABlasterPlayerController>(Character->Controller) : Controller;
+	const double ServerNow = Controller ? Controller->GetServerTime() : Now;
+	return NetTime::Quantize(ServerNow - (Now - ShotTime));
+}
 
-	bCanFire = true;
-	UE_LOG(LogTemp, Warning, TEXT("fire timer finished"));
-	if (bFireButtonPressed && EquippedWeapon->bAutomatic) {
-		Fire();
+void UCombatComponent::QueueFireInput(const FFireInput& Input) {
+	if (Character->HasAuthority()) {
+		ApplyFireInput(Input);
+		return;
 	}
-	ReloadEmptyWeapon();
+	PendingFireInputs.Add(Input);
 }
 
-// If invoked by client, this function's block of code will now run on the server.
-// If server, code will also run on server.
-void UCombatComponent::ServerFire_Implementation(const FVector_NetQuantize& TraceHitTarget, float FireDelay) {
-	MulticastFire(TraceHitTarget);
+/**
+* Sends every shot the server hasn't acknowledged yet. Called once a frame
+* after new shots are fired, and every FireInputResendInterval while any are
+* left unacknowledged.
+*/
+void UCombatComponent::SendFireInputs() {
+	RemoveAckedFireInputs();
+	FireInputResendTime = 0.f;
+	if (PendingFireInputs.IsEmpty()) return;
+
+	ServerFireInputs(PendingFireInputs);
 }
 
-bool UCombatComponent::ServerFire_Validate(const FVector_NetQuantize& TraceHitTarget, float FireDelay) {
-	if (EquippedWeapon) {
-		bool bNearlyEqual = FMath::IsNearlyEqual(EquippedWeapon->FireDelay, FireDelay, 0.001f);
-		return bNearlyEqual;
+bool UCombatComponent::IsFireInputBacklogFull() {
+	RemoveAckedFireInputs();
+	return PendingFireInputs.Num() >= MAX_FIRE_INPUTS;
+}
+
+void UCombatComponent::RemoveAckedFireInputs() {
+	int32 NumAcked = 0;
+	while (NumAcked < PendingFireInputs.Num() &&
+		!ShotNet::IsNewerSequence(PendingFireInputs[NumAcked].Sequence, LastServerShotSequence)) {
+		NumAcked++;
 	}
-	return true;
+	PendingFireInputs.RemoveAt(0, NumAcked, false);
 }
 
-// This function will always run on the server due to ServerFire being a Server keyword
-void UCombatComponent::MulticastFire_Implementation(const FVector_NetQuantize& TraceHitTarget) {
-	// If we get past this line we are either on the server,
-	// or on a client who is not controlling this particular character
-	if (Character && Character->IsLocallyControlled() && !Character->HasAuthority()) return;
-	LocalFire(TraceHitTarget);
+// Inputs are oldest first. Any the server already fired from an earlier
+// packet are skipped by their sequence number.
+void UCombatComponent::ServerFireInputs_Implementation(const TArray<FFireInput>& Inputs) {
+	for (const FFireInput& Input : Inputs) {
+		ApplyFireInput(Input);
+	}
 }
 
-void UCombatComponent::ServerShotgunFire_Implementation(const TArray<FVector_NetQuantize>& TraceHitTargets, float FireDelay) {
-	MulticastShotgunFire(TraceHitTargets);
+// Fire rate is enforced by AcceptShotTime against the server's own weapon, so
+// only a packet no honest client could send disconnects
+bool UCombatComponent::ServerFireInputs_Validate(const TArray<FFireInput>& Inputs) {
+	return Inputs.Num() <= MAX_FIRE_INPUTS;
 }
 
-bool UCombatComponent::ServerShotgunFire_Validate(const TArray<FVector_NetQuantize>& TraceHitTargets, float FireDelay) {
-	if (EquippedWeapon) {
-		bool bNearlyEqual = FMath::IsNearlyEqual(EquippedWeapon->FireDelay, FireDelay, 0.001f);
-		return bNearlyEqual;
+/**
+* The server plays the shot itself, which is what spends ammo and deals damage,
+* then leaves it to UShotEventSubsystem to tell the clients that can perceive it.
+* A shot rejected for its timestamp is still acknowledged, so the client is
+* told its predicted round was never spent.
+*/
+void UCombatComponent::ApplyFireInput(const FFireInput& Input) {
+	if (!ConsumeShotSequence(Input.Sequence)) return;
+	if (!AcceptShotTime(Input.Time)) {
+		if (EquippedWeapon && Character && !Character->IsLocallyControlled()) {
+			EquippedWeapon->RejectPredictedRound();
+		}
+		return;
+	}
+	FiredShotMask |= 1;
+	FiredShotAims[Input.Sequence % 64] = Input.Aim;
+	PlayShotEvent(Input);
+
+	UShotEventSubsystem* ShotEvents = GetWorld() ? GetWorld()->GetSubsystem<UShotEventSubsystem>() : nullptr;
+	if (ShotEvents) {
+		ShotEvents->QueueShot(Character, Input);
 	}
-	return true;
 }
 
-void UCombatComponent::MulticastShotgunFire_Implementation(const TArray<FVector_NetQuantize>& TraceHitTargets) {
-	if (Character && Character->IsLocallyControlled() && !Character->HasAuthority()) return;
-	LocalShotgunFire(TraceHitTargets);
+void UCombatComponent::PlayShotEvent(const FFireInput& Input) {
+	if (Input.bShotgun) {
+		LocalShotgunFire(Input);
+	} else {
+		LocalFire(Input.Aim, Input.Sequence);
+	}
 }
 
-void UCombatComponent::LocalFire(const FVector_NetQuantize& TraceHitTarget) {
-	if (EquippedWeapon == nullptr) return;
+void UCombatComponent::LocalFire(uint32 Aim, uint16 Sequence) {
+	FVector MuzzleLocation;
+	if (EquippedWeapon == nullptr || !EquippedWeapon->GetMuzzleLocation(MuzzleLocation)) return;
 
 	if (Character && CombatState == ECombatState::ECS_Unoccupied) {
 		Character->PlayFireMontage(bAiming);
-		EquippedWeapon->Fire(TraceHitTarget);
+		EquippedWeapon->Fire(GetShotTarget(MuzzleLocation, Aim, Sequence), Sequence);
 	}
 }
 
-void UCombatComponent::LocalShotgunFire(const TArray<FVector_NetQuantize>& TraceHitTargets) {
+void UCombatComponent::LocalShotgunFire(const FFireInput& Blast) {
 	AShotgun* Shotgun = Cast<AShotgun>(EquippedWeapon);
 	if (Shotgun == nullptr || Character == nullptr) return;
 	if (CombatState == ECombatState::ECS_Reloading || CombatState == ECombatState::ECS_Unoccupied) {
 		bLocallyReloading = false;
 		Character->PlayFireMontage(bAiming);
-		Shotgun->FireShotgun(TraceHitTargets);
+		Shotgun->FireShotgun(Blast);
 		CombatState = ECombatState::ECS_Unoccupied;
 	}
 }
 
+/**
+* Aim is relative to the firing client's muzzle, and each machine fires from
+* its own copy of the weapon, so shots start within a few centimetres of each
+* other and travel parallel.
+*/
+FVector UCombatComponent::GetShotTarget(const FVector& TraceStart, uint32 Aim, uint16 Sequence) const {
+	const FVector AimTarget = ShotNet::GetAimTarget(TraceStart, Aim);
+	if (EquippedWeapon == nullptr || !EquippedWeapon->bUseScatter) return AimTarget;
+
+	FRandomStream Stream(GetShotSeed(Sequence));
+	return EquippedWeapon->TraceEndWithScatter(TraceStart, AimTarget, Stream);
+}
+
+int32 UCombatComponent::GetShotSeed(uint16 Sequence) const {
+	return ShotNet::GetShotSeed(ScatterSeed, Sequence);
+}
+
+bool UCombatComponent::ConsumeShotSequence(uint16 Sequence) {
+	if (Sequence != static_cast<uint16>(LastServerShotSequence + 1)) return false;
+	FiredShotMask <<= 1;
+	LastServerShotSequence = Sequence;
+	return true;
+}
+
+/**
+* Shot timestamps have to be at least the weapon's fire delay apart, can't be
+* ahead of the server's clock, and can't be older than the shooter's rewind
+* window. However a client times its packets, it can't keep firing faster
+* than the weapon allows, and can't backdate a burst to fire it all at once.
+*/
+bool UCombatComponent::AcceptShotTime(uint16 Time) {
+	if (EquippedWeapon == nullptr) return false;
+
+	const double Now = GetWorld()->GetTimeSeconds();
+	const double ShotTime = NetTime::Dequantize(Time, Now);
+	const ABlasterPlayerState* PlayerState = Character ? Character->GetPlayerState<ABlasterPlayerState>() : nullptr;
+	const double OldestShotTime = Now - (PlayerState ? PlayerState->GetRoundTrip().GetRewindWindow() : 0.f) -
+		ShotTimeLagTolerance;
+	if (ShotTime < OldestShotTime || ShotTime > Now + MaxShotTimeLead) return false;
+
+	// After a pause, the last shot counts as no older than the oldest allowed,
+	// so a burst can't be spread over time from before the window
+	const float FireDelay = EquippedWeapon->FireDelay;
+	LastServerShotTime = FMath::Max(LastServerShotTime, OldestShotTime - FireDelay);
+	const float CadenceTolerance = FireCadenceTolerance +
+		(PlayerState ? PlayerState->GetRoundTrip().GetClockErrorBound() : 0.f);
+	if (ShotTime - LastServerShotTime < FireDelay - CadenceTolerance) {
+		return false;
+	}
+	// A shot let in early by the clock error bound doesn't bring the schedule
+	// forward, so the bound absorbs a clock adjustment but can't raise the
+	// sustained fire rate
+	LastServerShotTime = FMath::Max(ShotTime, LastServerShotTime + FireDelay - FireCadenceTolerance);
+	return true;
+}
+
+bool UCombatComponent::HasFiredShot(uint16 Sequence) const {
+	const uint16 Age = LastServerShotSequence - Sequence;
+	return Age < 64 && (FiredShotMask >> Age) & 1;
+}
+
+bool UCombatComponent::ConsumeFiredShot(uint16 Sequence) {
+	if (!HasFiredShot(Sequence)) return false;
+	FiredShotMask &= ~(uint64(1) << static_cast<uint16>(LastServerShotSequence - Sequence));
+	return true;
+}
+
+/**
+* Scatter only depends on the direction from the trace start, so the server's
+* ray from the client's trace start points the same way as the client's did.
+*/
+bool UCombatComponent::IsShotOnTarget(uint16 Sequence, const FVector& TraceStart, const FVector& HitTarget) const {
+	if (!HasFiredShot(Sequence)) return false;
+
+	const FVector ShotTarget = GetShotTarget(TraceStart, FiredShotAims[Sequence % 64], Sequence);
+	const FVector ShotDirection = (ShotTarget - TraceStart).GetSafeNormal();
+	const FVector HitDirection = (HitTarget - TraceStart).GetSafeNormal();
+	return FVector::DotProduct(ShotDirection, HitDirection) >=
+		FMath::Cos(FMath::DegreesToRadians(ShotDirectionTolerance));
+}
+
 void UCombatComponent::OnRep_CarriedAmmo() {
 	Controller = Controller == nullptr ? Cast<ABlasterPlayerController>(Character->Controller) : Controller;
 	if (Controller) {
@@ -7,6 +7,7 @@
 #include "Blaster/HUD/BlasterHUD.h"
 #include "Blaster/Weapon/WeaponTypes.h"
 #include "Blaster/BlasterTypes/CombatState.h"
+#include "Blaster/BlasterTypes/ShotEvent.h"
 #include "CombatComponent.generated.h"
 
 UCLASS(ClassGroup = (Custom), meta = (BlueprintSpawnableComponent))
@@ -48,6 +49,37 @@ public:
 
 	void PickupAmmo(EWeaponType WeaponType, int32 AmmoAmount);
 
+	/** Seed for the scatter of this character's shot with the given sequence number */
+	int32 GetShotSeed(uint16 Sequence) const;
+
+	/** Whether the server has seen this character fire the shot. Server only. */
+	bool HasFiredShot(uint16 Sequence) const;
+
+	/**
+	* Marks a fired shot as scored, so each shot can only ever score once.
+	* Server only.
+	*
+	* @return False if the server didn't fire the shot or it already scored
+	*/
+	bool ConsumeFiredShot(uint16 Sequence);
+
+	/**
+	* Whether a hitscan hit lies along the scattered ray of the shot it claims
+	* to come from. Server only.
+	*
+	* @param  Sequence The shot the hit was reported for
+	* @param  TraceStart Where the client traced the shot from
+	* @param  HitTarget The end of the client's trace
+	* @return False if the server didn't fire the shot or the ray doesn't match
+	*/
+	bool IsShotOnTarget(uint16 Sequence, const FVector& TraceStart, const FVector& HitTarget) const;
+
+	/** Fires a shot the client sent, unless it was already fired. Server only. */
+	void ApplyFireInput(const FFireInput& Input);
+
+	/** Plays a shot fired by this character somewhere else */
+	void PlayShotEvent(const FFireInput& Input);
+
 	bool bLocallyReloading = false;
 protected:
 	// Called when the game starts
@@ -64,26 +96,47 @@ protected:
 	void OnRep_SecondaryWeapon();
 
 	void Fire();
-	void FireProjectileWeapon();
-	void FireHitScanWeapon();
-	void FireShotgun();
-	void LocalFire(const FVector_NetQuantize& TraceHitTarget);
-	void LocalShotgunFire(const TArray<FVector_NetQuantize>& TraceHitTargets);
+	void FireProjectileWeapon(double ShotTime);
+	void FireHitScanWeapon(double ShotTime);
+	void FireShotgun(double ShotTime);
+	void LocalFire(uint32 Aim, uint16 Sequence);
+	void LocalShotgunFire(const FFireInput& Blast);
 
-	UFUNCTION(Server, Reliable, WithValidation)
-	void ServerFire(const FVector_NetQuantize& TraceHitTarget, float FireDelay);
+	/**
+	* Shots are sent as an aim direction and sequence number, see ShotNet.
+	* Every machine works out the scatter itself from the sequence number.
+	*
+	* Rather than a reliable RPC per shot, every packet carries all the shots
+	* the server hasn't acknowledged yet. A lost packet is covered by the next
+	* one instead of stalling the reliable channel while it's resent.
+	*/
+	void QueueFireInput(const FFireInput& Input);
+	void SendFireInputs();
+
+	UFUNCTION(Server, Unreliable, WithValidation)
+	void ServerFireInputs(const TArray<FFireInput>& Inputs);
 
-	UFUNCTION(Server, Reliable, WithValidation)
-	void ServerShotgunFire(const TArray<FVector_NetQuantize>& TraceHitTargets, float FireDelay);
+	/** Where a shot from the equipped weapon fired from TraceStart ends, after scatter */
+	FVector GetShotTarget(const FVector& TraceStart, uint32 Aim, uint16 Sequence) const;
 
-	// RPC from client to server so it will run on server and all clients
-	UFUNCTION(NetMulticast, Reliable)
-	void MulticastFire(const FVector_NetQuantize& TraceHitTarget);
+	/**
+	* Records a shot's sequence number on the server. False unless it directly
+	* follows the last one, so a client can't skip ahead to a sequence number
+	* with scatter it likes.
+	*/
+	bool ConsumeShotSequence(uint16 Sequence);
 
+	/** Drops the pending fire inputs the server has acknowledged */
+	void RemoveAckedFireInputs();
 
+	/** Whether MAX_FIRE_INPUTS shots are still waiting to be acknowledged */
+	bool IsFireInputBacklogFull();
 
-	UFUNCTION(NetMulticast, Reliable)
-	void MulticastShotgunFire(const TArray<FVector_NetQuantize>& TraceHitTargets);
+	/** Checks a shot's timestamp against the last accepted shot. Server only. */
+	bool AcceptShotTime(uint16 Time);
+
+	/** A shot's world time as a server timestamp for FFireInput */
+	uint16 GetShotNetTime(double ShotTime);
 
 	void TraceUnderCrosshairs(FHitResult& TraceHitResult);
 
@@ -161,6 +214,66 @@ private:
 
 	FVector HitTarget;
 
+	/**
+	* Shot sequence numbers and scatter
+	*/
+
+	// Chosen by the server when the component begins play, so a client can't
+	// pick a seed that scatters in its favour
+	UPROPERTY(Replicated)
+	int32 ScatterSeed = 0;
+
+	// Sequence number of the last shot this client fired
+	uint16 ShotSequence = 0;
+
+	// Sequence number of the last shot the server accepted. Replicated to the
+	// owner as the acknowledgement for its fire inputs.
+	UPROPERTY(Replicated)
+	uint16 LastServerShotSequence = 0;
+
+	// Which of the last 64 sequence numbers up to LastServerShotSequence the
+	// server actually fired, bit 0 for LastServerShotSequence itself. Shots
+	// that failed the cadence check are acknowledged but never fired. A shot's
+	// bit is cleared once a hit has been scored for it.
+	uint64 FiredShotMask = 0;
+
+	// Aim of each fired shot in FiredShotMask, indexed by sequence number mod 64
+	uint32 FiredShotAims[64] = {};
+
+	// Largest angle between the ray a hitscan hit was reported along and the
+	// ray the server scatters for the same shot, in degrees. Only has to cover
+	// aim compression and the rounding of the reported points.
+	UPROPERTY(EditAnywhere, Category = Combat)
+	float ShotDirectionTolerance = 0.5f;
+
+	// Timestamp of the last shot the server fired
+	double LastServerShotTime = TNumericLimits<double>::Lowest();
+
+	// How much closer together than the fire delay shot timestamps can always
+	// be, covering their millisecond rounding. The shooter's clock error bound
+	// is added on top to cover its clock sync adjusting.
+	UPROPERTY(EditAnywhere, Category = Combat)
+	float FireCadenceTolerance = 0.01f;
+
+	// How far ahead of the server's clock a shot can be stamped
+	UPROPERTY(EditAnywhere, Category = Combat)
+	float MaxShotTimeLead = 0.05f;
+
+	// How much older than the shooter's rewind window a shot can be stamped
+	UPROPERTY(EditAnywhere, Category = Combat)
+	float ShotTimeLagTolerance = 0.05f;
+
+	// Shots fired by this client that the server hasn't acknowledged, oldest
+	// first. The server needs every sequence number, so the client stops
+	// firing rather than dropping one once MAX_FIRE_INPUTS are waiting.
+	TArray<FFireInput> PendingFireInputs;
+
+	float FireInputResendTime = 0.f;
+
+	// How often unacknowledged shots are resent when no new shot is fired
+	UPROPERTY(EditAnywhere, Category = Combat)
+	float FireInputResendInterval = 0.03f;
+
 	float CrosshairAimFactor;
 
 	float CrosshairShootingFactor;
@@ -190,13 +303,16 @@ private:
 	* Automatic fire
 	*/
 
-	FTimerHandle FireTimer;
+	// World time the last shot's fire delay runs out. Kept exact rather than
+	// rounded to the frame it ran out in, so the fire rate doesn't depend on
+	// the frame rate.
+	double NextFireTime = 0.0;
 
 	bool bCanFire = true;
 
-	void StartFireTimer();
+	void FireAt(double ShotTime);
 
-	void FireTimerFinished();
+	void UpdateFireSchedule();
 
 	bool CanFire();
 
@@ -268,5 +384,6 @@ private:
 
 public:
 	FORCEINLINE int32 GetGrenades() const { return Grenades; }
+	FORCEINLINE const TArray<FFireInput>& GetPendingFireInputs() const { return PendingFireInputs; }
 	bool ShouldSwapWeapons();
 };
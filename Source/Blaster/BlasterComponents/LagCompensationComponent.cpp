@@ -4,122 +4,59 @@
 #include "Blaster/Character/BlasterCharacter.h"
 #include "Components/BoxComponent.h"
 #include "DrawDebugHelpers.h"
-#include "Components/BoxComponent.h"
 #include "Kismet/GameplayStatics.h"
 #include "Blaster/Weapon/Weapon.h"
+#include "Blaster/Weapon/Shotgun.h"
+#include "Blaster/BlasterComponents/CombatComponent.h"
 #include "Blaster/Blaster.h"
+#include "Blaster/LagCompensation/HitBoxMath.h"
+#include "Blaster/LagCompensation/RewindHistorySubsystem.h"
+#include "Blaster/LagCompensation/HitValidationSubsystem.h"
+#include "Blaster/LagCompensation/HitBoxTree.h"
+#include "Blaster/LagCompensation/NetTime.h"
+#include "Misc/MemStack.h"
+#include "Blaster/PlayerState/BlasterPlayerState.h"
 
 ULagCompensationComponent::ULagCompensationComponent() {
-	// Set this component to be initialized when the game starts, and to be ticked every frame.  You can turn these features
-	// off to improve performance if you don't need them.
+	// History is recorded for every character at once by URewindHistorySubsystem.
+	// Only the owning client ticks, and only on frames it has hits to send.
 	PrimaryComponentTick.bCanEverTick = true;
+	PrimaryComponentTick.bStartWithTickEnabled = false;
 }
 
-
-
 void ULagCompensationComponent::BeginPlay() {
 	Super::BeginPlay();
-}
-
-void ULagCompensationComponent::TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) {
-	Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
-
-	SaveFramePackage();
-}
 
-void ULagCompensationComponent::SaveFramePackage() {
-	if (Character == nullptr || !Character->HasAuthority()) return;
-
-	// If Frame history is empty, Save a frame and make it the head
-	if (FrameHistory.Num() <= 1) {
-		FFramePackage ThisFrame;
-		SaveFramePackage(ThisFrame);
-		FrameHistory.AddHead(ThisFrame);
-	} else {
-		// Latest frame time minus the oldest frame time
-		float HistoryLength = FrameHistory.GetHead()->GetValue().Time - FrameHistory.GetTail()->GetValue().Time;
-		// While the history is greater than the maximum record time, remove the tail(s)
-		while (HistoryLength > MaxRecordTime) {
-			FrameHistory.RemoveNode(FrameHistory.GetTail());
-			HistoryLength = FrameHistory.GetHead()->GetValue().Time - FrameHistory.GetTail()->GetValue().Time;
+	if (GetOwner() && GetOwner()->HasAuthority() && GetWorld()) {
+		Character = Character == nullptr ? Cast<ABlasterCharacter>(GetOwner()) : Character;
+		RewindHistory = GetWorld()->GetSubsystem<URewindHistorySubsystem>();
+		if (RewindHistory) {
+			RewindHistory->RegisterCharacter(Character);
 		}
-		// Add the current frame to the history
-		FFramePackage ThisFrame;
-		SaveFramePackage(ThisFrame);
-		FrameHistory.AddHead(ThisFrame);
-
-		// Show full history of hitboxes in game
-		// ShowFramePackage(ThisFrame, FColor::Red);
 	}
 }
 
-/**
-* This function will be called every frame. It will take an empty FFramePackage
-* as its input and fill the package with the this owning character's hitbox
-* location, rotation, and extent in world space.
-*
-* @param Package An empty package for storing hotbox data
-*/
-void ULagCompensationComponent::SaveFramePackage(FFramePackage& Package) {
-	Character = Character == nullptr ? Cast<ABlasterCharacter>(GetOwner()) : Character;
-	if (Character) {
-		Package.Time = GetWorld()->GetTimeSeconds();
-		Package.Character = Character;
-		for (auto& BoxPair : Character->HitCollisionBoxes) {
-			FBoxInformation BoxInformation;
-			BoxInformation.Location = BoxPair.Value->GetComponentLocation();
-			BoxInformation.Rotation = BoxPair.Value->GetComponentRotation();
-			BoxInformation.BoxExtent = BoxPair.Value->GetScaledBoxExtent();
-			Package.HitBoxInfo.Add(BoxPair.Key, BoxInformation);
-		}
+void ULagCompensationComponent::EndPlay(const EEndPlayReason::Type EndPlayReason) {
+	if (RewindHistory) {
+		RewindHistory->UnregisterCharacter(Character);
 	}
+	Super::EndPlay(EndPlayReason);
 }
 
-/**
-* When a HitTime is found to be within the range of the oldest frame history
-* and youngest frame history, which was judged in the ServerSideRewind function,
-* An Interpolation is done between younger and older to determine where the
-* hitboxes were at HitTime
-*
-* @param  OlderFrame The frame that was found to be adjacent to HiTime on
-*		  the older side of the frame history
-* @param  YoungerFrame The frame that was found to be adjacent to HitTime on
-*		  the younger side of the frame history
-* @param  HitTime The local time of when a player shot their bullet
-* @return A FramePackage with hitboxes interpolated between younger and older
-*		  frame at the point of HitTime
-*/
-FFramePackage ULagCompensationComponent::InterpBetweenFrames(
-	FFramePackage& OlderFrame, FFramePackage& YoungerFrame, float HitTime) {
-	const float Distance = YoungerFrame.Time - OlderFrame.Time;
-	const float InterpFraction = FMath::Clamp((HitTime - OlderFrame.Time) / Distance, 0.f, 1.f);
-
-	FFramePackage InterpFramePackage;
-	InterpFramePackage.Time = HitTime;
-
-	for (auto& YoungerPair : YoungerFrame.HitBoxInfo) {
-		const FName& BoxInfoName = YoungerPair.Key;
-
-		const FBoxInformation& OlderBox = OlderFrame.HitBoxInfo[BoxInfoName];
-		const FBoxInformation& YoungerBox = YoungerFrame.HitBoxInfo[BoxInfoName];
-
-		FBoxInformation InterpBoxInfo;
-
-		InterpBoxInfo.Location = FMath::VInterpTo(OlderBox.Location, YoungerBox.Location, 1.f, InterpFraction);
-		InterpBoxInfo.Rotation = FMath::RInterpTo(OlderBox.Rotation, YoungerBox.Rotation, 1.f, InterpFraction);
-		InterpBoxInfo.BoxExtent = YoungerBox.BoxExtent;
-
-		InterpFramePackage.HitBoxInfo.Add(BoxInfoName, InterpBoxInfo);
-	}
+void ULagCompensationComponent::TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) {
+	Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
 
-	return InterpFramePackage;
+	SendScoreRequests();
+	SetComponentTickEnabled(false);
 }
+
 /**
 * The definitive function to check if the character was hit or not with lag
-* compensation in mind. This function take a note (cache) of where the current
-* HitCharacter is on the server and then moves all of its hitboxes to the
-* position of where it was at HitTime (which likely has been interpolated).
-* This is done so a line trace can be used to determine a hit or not.
+* compensation in mind. The trace is tested directly against the rewound boxes
+* in Package, so the HitCharacter's live hitboxes are never moved and no
+* collision is toggled. A hit on the head takes priority over any body box,
+* otherwise the closest body box along the trace counts. The level can still
+* block the shot, which is checked with one world trace.
 *
 * @param  Package A frame, likely interpolated, which denotes where the
 		  HitCharacter's position was in the past when the instigator fired
@@ -129,360 +66,248 @@ FFramePackage ULagCompensationComponent::InterpBetweenFrames(
 * @param  TraceStart The starting vector to be used for the line trace
 * @param  HitLocation The location in world space where the instigator hit the
 *		  character on their client.
-* @return The result of the line trace and whether there was a hit or not and
-		  whether it was a headshot or not
+* @return Whether there was a hit or not and whether it was a headshot or not
 */
 FServerSideRewindResult ULagCompensationComponent::ConfirmHit(
 	const FFramePackage& Package,
 	ABlasterCharacter* HitCharacter,
 	const FVector_NetQuantize& TraceStart,
-	const FVector_NetQuantize& HitLocation) {
+	const FVector_NetQuantize& HitLocation) const {
 	if (HitCharacter == nullptr) return FServerSideRewindResult();
 
-	FFramePackage CurrentFrame;
-	CacheBoxPositions(HitCharacter, CurrentFrame);
-	MoveBoxes(HitCharacter, Package);
-	// Disabling collision for HitCharacter's mesh so the line trace wouldn't interfere with it
-	EnableCharacterMeshCollision(HitCharacter, ECollisionEnabled::NoCollision);
-
-	// Enable collision for the head first
-	UBoxComponent* HeadBox = HitCharacter->HitCollisionBoxes[FName("head")];
-	// Get the head hitbox
-	HeadBox->SetCollisionEnabled(ECollisionEnabled::QueryAndPhysics);
-	// Turn on its collision for line trace
-	HeadBox->SetCollisionResponseToChannel(ECC_HitBox, ECollisionResponse::ECR_Block);
+	const FVector TraceEnd = TraceStart + (HitLocation - TraceStart) * 1.25f;
 
-	FHitResult ConfirmHitResult;
+	float HeadTime = -1.f;
+	float BodyTime = -1.f;
+	if (!TraceHitBoxes(Package, TraceStart, TraceEnd, HeadTime, BodyTime)) {
+		return FServerSideRewindResult{ false, false };
+	}
 
-	const FVector TraceEnd = TraceStart + (HitLocation - TraceStart) * 1.25f;
-	UWorld* World = GetWorld();
-	if (World) {
-		World->LineTraceSingleByChannel(ConfirmHitResult, TraceStart,
-			TraceEnd, ECC_HitBox);
-		if (ConfirmHitResult.bBlockingHit) { // Headshot confirmed
-
-			if (ConfirmHitResult.Component.IsValid()) {
-				UBoxComponent* Box = Cast<UBoxComponent>(ConfirmHitResult.Component);
-				if (Box) {
-					/*
-					DrawDebugBox(GetWorld(), 
-						Box->GetComponentLocation(), 
-						Box->GetScaledBoxExtent(), 
-						FQuat(Box->GetComponentRotation()), 
-						FColor::Red, false, 8.f);
-						*/
-				}
-			}
+	// One world trace out to the furthest box hit tells us how far along the
+	// trace the level lets the shot travel
+	const float FurthestTime = FMath::Max(HeadTime, BodyTime);
+	const float ClearTime = GetUnoccludedTime(TraceStart,
+		FMath::Lerp(TraceStart, TraceEnd, FurthestTime), HitCharacter) * FurthestTime;
 
-			ResetHitBoxes(HitCharacter, CurrentFrame);
-			EnableCharacterMeshCollision(HitCharacter, ECollisionEnabled::QueryAndPhysics);
-			return FServerSideRewindResult{ true, true };
-		} else { // No headshot so checking the other hitboxes
-			for (auto& HitBoxPair : HitCharacter->HitCollisionBoxes) {
-				if (HitBoxPair.Value != nullptr) { // Turning on collision for hit boxes
-					HitBoxPair.Value->SetCollisionEnabled(ECollisionEnabled::QueryAndPhysics);
-					HitBoxPair.Value->SetCollisionResponseToChannel(ECC_HitBox, ECollisionResponse::ECR_Block);
-				}
-			}
-			World->LineTraceSingleByChannel(ConfirmHitResult, TraceStart,
-				TraceEnd, ECC_HitBox);
-			if (ConfirmHitResult.bBlockingHit) {
-
-				if (ConfirmHitResult.Component.IsValid()) {
-					UBoxComponent* Box = Cast<UBoxComponent>(ConfirmHitResult.Component);
-					if (Box) {
-						/*
-						DrawDebugBox(GetWorld(), 
-							Box->GetComponentLocation(), 
-							Box->GetScaledBoxExtent(), 
-							FQuat(Box->GetComponentRotation()), 
-							FColor::Blue, false, 8.f);
-							*/
-					}
-				}
-				ResetHitBoxes(HitCharacter, CurrentFrame);
-				EnableCharacterMeshCollision(HitCharacter, ECollisionEnabled::QueryAndPhysics);
-				return FServerSideRewindResult{ true, false };
-			}
-		}
+	if (HeadTime >= 0.f && HeadTime <= ClearTime) { // Headshot confirmed
+		// DrawDebugBox(GetWorld(), Package.Locations[HITBOX_HEAD], Package.BoxExtents[HITBOX_HEAD], Package.Rotations[HITBOX_HEAD], FColor::Red, false, 8.f);
+		return FServerSideRewindResult{ true, true };
+	}
+	if (BodyTime >= 0.f && BodyTime <= ClearTime) {
+		return FServerSideRewindResult{ true, false };
 	}
 	// Past this comment, no confirmed hit detected
-	ResetHitBoxes(HitCharacter, CurrentFrame);
-	EnableCharacterMeshCollision(HitCharacter, ECollisionEnabled::QueryAndPhysics);
 	return FServerSideRewindResult{ false, false };
 }
 
+/**
+* Tests a segment against every rewound box of a frame.
+*
+* @param  Package The frame with the boxes to test against
+* @param  TraceStart Start of the segment
+* @param  TraceEnd End of the segment
+* @param  OutHeadTime Fraction along the segment where it enters the head box,
+*		  or -1 if it misses the head
+* @param  OutBodyTime Fraction along the segment where it enters the closest
+*		  other box, or -1 if it misses them all
+* @return Whether any box was hit
+*/
+bool ULagCompensationComponent::TraceHitBoxes(const FFramePackage& Package,
+	const FVector& TraceStart, const FVector& TraceEnd,
+	float& OutHeadTime, float& OutBodyTime) const {
+	OutHeadTime = -1.f;
+	OutBodyTime = -1.f;
+
+	for (int32 i = 0; i < HITBOX_NUM; i++) {
+		float EnterTime;
+		const bool bHit = HitBoxMath::SegmentIntersectsBox(TraceStart, TraceEnd,
+			Package.Locations[i], Package.Rotations[i], Package.BoxExtents[i], EnterTime);
+		if (!bHit) continue;
+
+		if (i == HITBOX_HEAD) {
+			OutHeadTime = EnterTime;
+		} else if (OutBodyTime < 0.f || EnterTime < OutBodyTime) {
+			OutBodyTime = EnterTime;
+		}
+	}
+	return OutHeadTime >= 0.f || OutBodyTime >= 0.f;
+}
+
+/**
+* Traces the level between two points to see whether anything static blocks a
+* shot. Characters are never considered, since their live collision does not
+* match where they were at the rewound time.
+*
+* @param  TraceStart Where the shot came from
+* @param  TraceEnd The furthest point the shot has to reach
+* @param  HitCharacter The character being checked, ignored by the trace
+* @return Fraction of the way to TraceEnd the shot gets before being blocked,
+*		  1 if nothing blocks it
+*/
+float ULagCompensationComponent::GetUnoccludedTime(const FVector& TraceStart,
+	const FVector& TraceEnd, ABlasterCharacter* HitCharacter) const {
+	UWorld* World = GetWorld();
+	if (World == nullptr) return 1.f;
+
+	FCollisionQueryParams QueryParams(SCENE_QUERY_STAT(LagCompensationOcclusion));
+	QueryParams.AddIgnoredActor(GetOwner());
+	QueryParams.AddIgnoredActor(HitCharacter);
+
+	FHitResult OcclusionHit;
+	World->LineTraceSingleByObjectType(OcclusionHit, TraceStart, TraceEnd,
+		FCollisionObjectQueryParams(ECC_WorldStatic), QueryParams);
+	return OcclusionHit.bBlockingHit ? OcclusionHit.Time : 1.f;
+}
+
+/**
+* Replays a projectile's flight from when it was fired. The arc is split into
+* steps and each step is tested against the victim's boxes as they were at that
+* step's own time, so a fast bullet is checked against where the victim was
+* when the bullet actually got there. The projectile's radius is accounted for
+* by growing the boxes by it.
+*
+* @param  HitCharacter The character the projectile hit on the client
+* @param  TraceStart Where the projectile was spawned
+* @param  InitialVelocity The projectile's launch velocity
+* @param  FireTime Server time at which the client fired the projectile
+* @return Whether there was a hit or not and whether it was a headshot or not
+*/
 FServerSideRewindResult ULagCompensationComponent::ProjectileConfirmHit(
-	const FFramePackage& Package, ABlasterCharacter* HitCharacter, 
-	const FVector_NetQuantize& TraceStart, const FVector_NetQuantize100& InitialVelocity, float HitTime) {
-
-	FFramePackage CurrentFrame;
-	CacheBoxPositions(HitCharacter, CurrentFrame);
-	MoveBoxes(HitCharacter, Package);
-	// Disabling collision for HitCharacter's mesh so the line trace wouldn't interfere with it
-	EnableCharacterMeshCollision(HitCharacter, ECollisionEnabled::NoCollision);
-
-	// Enable collision for the head first
-	UBoxComponent* HeadBox = HitCharacter->HitCollisionBoxes[FName("head")];
-	// Get the head hitbox
-	HeadBox->SetCollisionEnabled(ECollisionEnabled::QueryAndPhysics);
-	// Turn on its collision for line trace
-	HeadBox->SetCollisionResponseToChannel(ECC_HitBox, ECollisionResponse::ECR_Block);
-
-	FPredictProjectilePathParams PathParams;
-	PathParams.bTraceWithCollision = true;
-	PathParams.MaxSimTime = MaxRecordTime;
-	PathParams.LaunchVelocity = InitialVelocity;
-	PathParams.StartLocation = TraceStart;
-	PathParams.SimFrequency = 15.f;
-	PathParams.ProjectileRadius = 5.f;
-	PathParams.TraceChannel = ECC_HitBox;
-	PathParams.ActorsToIgnore.Add(GetOwner());
-	PathParams.DrawDebugTime = 5.f;
-	PathParams.DrawDebugType = EDrawDebugTrace::ForDuration;
-
-	FPredictProjectilePathResult PathResult;
-	UGameplayStatics::PredictProjectilePath(this, PathParams, PathResult);
-
-	if (PathResult.HitResult.bBlockingHit) { // Headshot confirmed
-		if (PathResult.HitResult.Component.IsValid()) {
-			UBoxComponent* Box = Cast<UBoxComponent>(PathResult.HitResult.Component);
-			if (Box) {
-				/*
-				DrawDebugBox(GetWorld(),
-					Box->GetComponentLocation(),
-					Box->GetScaledBoxExtent(),
-					FQuat(Box->GetComponentRotation()),
-					FColor::Red, false, 8.f);
-					*/
-			}
-			ResetHitBoxes(HitCharacter, CurrentFrame);
-			EnableCharacterMeshCollision(HitCharacter, ECollisionEnabled::QueryAndPhysics);
-			return FServerSideRewindResult{ true, true };
+	ABlasterCharacter* HitCharacter, const FVector_NetQuantize& TraceStart,
+	const FVector_NetQuantize100& InitialVelocity, double FireTime) const {
+	UWorld* World = GetWorld();
+	if (World == nullptr || RewindHistory == nullptr || ProjectileSimFrequency <= 0.f) {
+		return FServerSideRewindResult();
+	}
+
+	const FVector Gravity(0.f, 0.f, World->GetGravityZ());
+	const float StepTime = 1.f / ProjectileSimFrequency;
+	// The projectile can't have flown for longer than since it was fired
+	const float MaxSimTime = FMath::Clamp(static_cast<float>(RewindHistory->GetTimestamp() - FireTime),
+		StepTime, RewindHistory->GetMaxRecordTime());
+	const FVector InflateExtent(ProjectileRadius);
+
+	FVector StepStart = TraceStart;
+	FFramePackage Frame;
+	for (float SimTime = StepTime; SimTime - StepTime < MaxSimTime; SimTime += StepTime) {
+		const FVector StepEnd = TraceStart + InitialVelocity * SimTime + 0.5f * Gravity * SimTime * SimTime;
+		const FVector SegmentStart = StepStart;
+		StepStart = StepEnd;
+
+		// The projectile was still in flight before the history starts
+		if (!RewindHistory->GetFrameAtTime(HitCharacter, FireTime + SimTime, Frame)) continue;
+
+		FVector BoundsCenter;
+		float BoundsRadius;
+		GetFrameBounds(Frame, BoundsCenter, BoundsRadius);
+		const FVector ClosestPoint = FMath::ClosestPointOnSegment(BoundsCenter, SegmentStart, StepEnd);
+		if (FVector::DistSquared(ClosestPoint, BoundsCenter) > FMath::Square(BoundsRadius + ProjectileRadius)) {
+			continue;
 		}
-	} else { // no headshot, check the rest of the hitboxes
-		for (auto& HitBoxPair : HitCharacter->HitCollisionBoxes) {
-			if (HitBoxPair.Value != nullptr) { // Turning on collision for hit boxes
-				HitBoxPair.Value->SetCollisionEnabled(ECollisionEnabled::QueryAndPhysics);
-				HitBoxPair.Value->SetCollisionResponseToChannel(ECC_HitBox, ECollisionResponse::ECR_Block);
-			}
+
+		for (int32 i = 0; i < HITBOX_NUM; i++) {
+			Frame.BoxExtents[i] += InflateExtent;
 		}
-		UGameplayStatics::PredictProjectilePath(this, PathParams, PathResult);
-		if (PathResult.HitResult.bBlockingHit) {
-			if (PathResult.HitResult.Component.IsValid()) {
-				UBoxComponent* Box = Cast<UBoxComponent>(PathResult.HitResult.Component);
-				if (Box) {
-					/*
-					DrawDebugBox(GetWorld(),
-						Box->GetComponentLocation(),
-						Box->GetScaledBoxExtent(),
-						FQuat(Box->GetComponentRotation()),
-						FColor::Blue, false, 8.f);
-						*/
-				}
-			}
-			ResetHitBoxes(HitCharacter, CurrentFrame);
-			EnableCharacterMeshCollision(HitCharacter, ECollisionEnabled::QueryAndPhysics);
-			return FServerSideRewindResult{ true, false };
+		float HeadTime = -1.f;
+		float BodyTime = -1.f;
+		if (TraceHitBoxes(Frame, SegmentStart, StepEnd, HeadTime, BodyTime)) {
+			const bool bHeadShot = HeadTime >= 0.f && (BodyTime < 0.f || HeadTime <= BodyTime);
+			return FServerSideRewindResult{ true, bHeadShot };
 		}
 	}
 	// Past this comment, no confirmed hit detected
-	ResetHitBoxes(HitCharacter, CurrentFrame);
-	EnableCharacterMeshCollision(HitCharacter, ECollisionEnabled::QueryAndPhysics);
 	return FServerSideRewindResult{ false, false };
 }
 
 /**
-* TODO comment
+* Confirms every pellet of a shotgun blast in one pass over the rewound frames.
+* Each pellet is first tested against a bounding sphere around each character's
+* rewound pose, and only the characters it passes near have their boxes tested.
+* The pellet counts against the nearest box it enters, as a headshot if that
+* box is the head, and is then checked against the level like a hitscan shot.
+*
+* @param  FramePackages Rewound frames, one per character the client hit and in
+*		  the same order
+* @param  TraceStart Where the pellets were fired from
+* @param  HitLocations The end point of each pellet's trace on the client
+* @return Head and body pellet counts for each character in FramePackages
 */
 FShotgunServerSideRewindResult ULagCompensationComponent::ShotgunConfirmHit(
-	const TArray<FFramePackage>& FramePackages,
+	TArrayView<const FFramePackage> FramePackages,
 	const FVector_NetQuantize& TraceStart,
-	const TArray<FVector_NetQuantize>& HitLocations) {
-	for (auto& Frame : FramePackages) {
-		if (Frame.Character == nullptr) return FShotgunServerSideRewindResult();
-	}
-
+	TArrayView<const FVector_NetQuantize> HitLocations) const {
 	FShotgunServerSideRewindResult ShotgunResult;
-	TArray<FFramePackage> CurrentFrames;
-
-	for (const FFramePackage& Frame : FramePackages) {
-		FFramePackage CurrentFrame;
-		CurrentFrame.Character = Frame.Character;
-		CacheBoxPositions(Frame.Character, CurrentFrame);
-		MoveBoxes(Frame.Character, Frame);
-		// Disabling collision for Frame.Character's mesh so the line trace wouldn't interfere with it
-		EnableCharacterMeshCollision(Frame.Character, ECollisionEnabled::NoCollision);
-		CurrentFrames.Add(CurrentFrame);
-	}
 
-	for (const FFramePackage& Frame : FramePackages) {
-		// Enable collision for the head first
-		UBoxComponent* HeadBox = Frame.Character->HitCollisionBoxes[FName("head")];
-		// Get the head hitbox
-		HeadBox->SetCollisionEnabled(ECollisionEnabled::QueryAndPhysics);
-		// Turn on its collision for line trace
-		HeadBox->SetCollisionResponseToChannel(ECC_HitBox, ECollisionResponse::ECR_Block);
+	const int32 NumTargets = FMath::Min(FramePackages.Num(), SHOTGUN_MAX_TARGETS);
+	FVector BoundsCenters[SHOTGUN_MAX_TARGETS];
+	float BoundsRadii[SHOTGUN_MAX_TARGETS];
+	for (int32 Target = 0; Target < NumTargets; Target++) {
+		if (FramePackages[Target].Character == nullptr) return ShotgunResult;
+		GetFrameBounds(FramePackages[Target], BoundsCenters[Target], BoundsRadii[Target]);
 	}
-	UWorld* World = GetWorld();
-	// Check for headshots
+
 	for (const FVector_NetQuantize& HitLocation : HitLocations) {
-		FHitResult ConfirmHitResult;
 		const FVector TraceEnd = TraceStart + (HitLocation - TraceStart) * 1.25f;
 
-		if (World) {
-			World->LineTraceSingleByChannel(ConfirmHitResult, TraceStart,
-				TraceEnd, ECC_HitBox);
-
-			ABlasterCharacter* BlasterCharacter =
-				Cast<ABlasterCharacter>(ConfirmHitResult.GetActor());
-
-			if (BlasterCharacter) {
-
-				if (ConfirmHitResult.Component.IsValid()) {
-					UBoxComponent* Box = Cast<UBoxComponent>(ConfirmHitResult.Component);
-					if (Box) {
-						//DrawDebugBox(GetWorld(), Box->GetComponentLocation(), Box->GetScaledBoxExtent(), FQuat(Box->GetComponentRotation()), FColor::Red, false, 8.f);
-					}
-				}
-				if (ShotgunResult.HeadShots.Contains(BlasterCharacter)) {
-					ShotgunResult.HeadShots[BlasterCharacter]++;
-				} else {
-					ShotgunResult.HeadShots.Emplace(BlasterCharacter, 1);
-				}
-			}
-		}
-	}
-	// Enable collision for all boxes, then disable for headbox
-	for (const FFramePackage& Frame : FramePackages) {
-		for (auto& HitBoxPair : Frame.Character->HitCollisionBoxes) {
-			if (HitBoxPair.Value != nullptr) { // Turning on collision for hit boxes
-				HitBoxPair.Value->SetCollisionEnabled(
-					ECollisionEnabled::QueryAndPhysics);
-				HitBoxPair.Value->SetCollisionResponseToChannel(
-					ECC_HitBox,
-					ECollisionResponse::ECR_Block);
+		int32 HitTarget = INDEX_NONE;
+		float HitTime = 1.f;
+		bool bHitHead = false;
+		for (int32 Target = 0; Target < NumTargets; Target++) {
+			// Broadphase, skip characters the pellet doesn't pass near
+			const FVector ClosestPoint = FMath::ClosestPointOnSegment(BoundsCenters[Target], TraceStart, TraceEnd);
+			if (FVector::DistSquared(ClosestPoint, BoundsCenters[Target]) > FMath::Square(BoundsRadii[Target])) {
+				continue;
 			}
-		}
-		UBoxComponent* HeadBox = Frame.Character->HitCollisionBoxes[FName("head")];
-		HeadBox->SetCollisionEnabled(ECollisionEnabled::NoCollision);
-	}
 
-	// Check for bodyshots
-	for (const FVector_NetQuantize& HitLocation : HitLocations) {
-		FHitResult ConfirmHitResult;
-		const FVector TraceEnd = TraceStart + (HitLocation - TraceStart) * 1.25f;
-
-		if (World) {
-			World->LineTraceSingleByChannel(ConfirmHitResult, TraceStart,
-				TraceEnd, ECC_HitBox);
-
-			ABlasterCharacter* BlasterCharacter =
-				Cast<ABlasterCharacter>(ConfirmHitResult.GetActor());
-
-			if (BlasterCharacter) {
-
-				if (ConfirmHitResult.Component.IsValid()) {
-					UBoxComponent* Box = Cast<UBoxComponent>(ConfirmHitResult.Component);
-					if (Box) {
-						//DrawDebugBox(GetWorld(), Box->GetComponentLocation(), Box->GetScaledBoxExtent(), FQuat(Box->GetComponentRotation()), FColor::Blue, false, 8.f);
-					}
-				}
-				if (ShotgunResult.BodyShots.Contains(BlasterCharacter)) {
-					ShotgunResult.BodyShots[BlasterCharacter]++;
-				} else {
-					ShotgunResult.BodyShots.Emplace(BlasterCharacter, 1);
-				}
+			float HeadTime = -1.f;
+			float BodyTime = -1.f;
+			if (!TraceHitBoxes(FramePackages[Target], TraceStart, TraceEnd, HeadTime, BodyTime)) {
+				continue;
+			}
+			const bool bHead = HeadTime >= 0.f && (BodyTime < 0.f || HeadTime <= BodyTime);
+			const float EnterTime = bHead ? HeadTime : BodyTime;
+			if (EnterTime <= HitTime) {
+				HitTarget = Target;
+				HitTime = EnterTime;
+				bHitHead = bHead;
 			}
 		}
-	}
+		if (HitTarget == INDEX_NONE) continue;
 
-	for (const FFramePackage& Frame : CurrentFrames) {
-		ResetHitBoxes(Frame.Character, Frame);
-		EnableCharacterMeshCollision(Frame.Character,
-			ECollisionEnabled::QueryAndPhysics);
+		const FVector HitPoint = FMath::Lerp(TraceStart, TraceEnd, HitTime);
+		if (GetUnoccludedTime(TraceStart, HitPoint, FramePackages[HitTarget].Character) < 1.f) {
+			continue;
+		}
+		if (bHitHead) {
+			ShotgunResult.HeadShots[HitTarget]++;
+		} else {
+			ShotgunResult.BodyShots[HitTarget]++;
+		}
 	}
 	return ShotgunResult;
 }
 
 /**
-* Since the server will be checking the HitCharacters location in the past, it
-* will move its hit boxes to that position but it will also need to to cache its
-* current position so it can switch back after checking if a hit was confirmed
-* or not.
+* Finds a sphere that contains every box of a frame. Cheap to test a trace
+* against before testing the boxes themselves.
 *
-* @param HitCharacter The character which will have its hitboxes cached
-* @param OutFramePackage The out-parameter for which hitbox data will be stored
+* @param Package The frame to bound
+* @param OutCenter Centre of the sphere, the average of the box centres
+* @param OutRadius Radius of the sphere
 */
-void ULagCompensationComponent::CacheBoxPositions(
-	ABlasterCharacter* HitCharacter, FFramePackage& OutFramePackage) {
-	if (HitCharacter == nullptr) return;
-
-	for (TPair<FName, UBoxComponent*>& HitBoxPair : HitCharacter->HitCollisionBoxes) {
-		if (HitBoxPair.Value != nullptr) {
-			FBoxInformation BoxInfo;
-			BoxInfo.Location = HitBoxPair.Value->GetComponentLocation();
-			BoxInfo.Rotation = HitBoxPair.Value->GetComponentRotation();
-			BoxInfo.BoxExtent = HitBoxPair.Value->GetScaledBoxExtent();
-			OutFramePackage.HitBoxInfo.Add(HitBoxPair.Key, BoxInfo);
-		}
+void ULagCompensationComponent::GetFrameBounds(const FFramePackage& Package,
+	FVector& OutCenter, float& OutRadius) {
+	OutCenter = FVector::ZeroVector;
+	for (int32 i = 0; i < HITBOX_NUM; i++) {
+		OutCenter += Package.Locations[i];
 	}
-}
+	OutCenter /= HITBOX_NUM;
 
-/**
-* A function closely relevant to CacheBoxPositions. This function will take a
-* character and shift its hitboxes to the position from the given frame package.
-*
-* @param HitCharacter The character to have their hitboxes shifted
-* @param Package A package with hitbox location data to shift the HitCharacter's
-*		 hitboxes to
-*/
-void ULagCompensationComponent::MoveBoxes(ABlasterCharacter* HitCharacter,
-	const FFramePackage& Package) {
-	if (HitCharacter == nullptr) return;
-	for (TPair<FName, UBoxComponent*>& HitBoxPair : HitCharacter->HitCollisionBoxes) {
-		if (HitBoxPair.Value != nullptr) {
-			HitBoxPair.Value->SetWorldLocation(Package.HitBoxInfo[HitBoxPair.Key].Location);
-			HitBoxPair.Value->SetWorldRotation(Package.HitBoxInfo[HitBoxPair.Key].Rotation);
-			HitBoxPair.Value->SetBoxExtent(Package.HitBoxInfo[HitBoxPair.Key].BoxExtent);
-		}
-	}
-}
-/**
-* This function should be used to shift the character's hitboxes back to their
-* original current position after shifting them prior to check for a lag
-* compensated hit. This is different than MoveBoxes because collision shall be
-* re-enabled in this process.
-*
-* @param HitCharacter The character to have their hitboxes shifted
-* @param Package A package with hitbox location data to shift the HitCharacter's
-*		 hitboxes to
-*/
-void ULagCompensationComponent::ResetHitBoxes(ABlasterCharacter* HitCharacter,
-	const FFramePackage& Package) {
-	if (HitCharacter == nullptr) return;
-	for (TPair<FName, UBoxComponent*>& HitBoxPair : HitCharacter->HitCollisionBoxes) {
-		if (HitBoxPair.Value != nullptr) {
-			HitBoxPair.Value->SetWorldLocation(Package.HitBoxInfo[HitBoxPair.Key].Location);
-			HitBoxPair.Value->SetWorldRotation(Package.HitBoxInfo[HitBoxPair.Key].Rotation);
-			HitBoxPair.Value->SetBoxExtent(Package.HitBoxInfo[HitBoxPair.Key].BoxExtent);
-			HitBoxPair.Value->SetCollisionEnabled(ECollisionEnabled::NoCollision);
-		}
-	}
-}
-/**
-* A function to enable to disable a character's mesh collision. This could be
-* used so the mesh would not interfere with a hitbox linetrace.
-*
-* @param HitCharacter A character to enable/disable collision. Typically this
-*		 should be the character that will be getting checked for a line trace.
-*
-* @param CollisionEnabled Enable or disable collision for HitCharacter.
-*/
-void ULagCompensationComponent::EnableCharacterMeshCollision(
-	ABlasterCharacter* HitCharacter, ECollisionEnabled::Type CollisionEnabled) {
-	if (HitCharacter && HitCharacter->GetMesh()) {
-		HitCharacter->GetMesh()->SetCollisionEnabled(CollisionEnabled);
+	// A box's half diagonal bounds it whatever its rotation
+	OutRadius = 0.f;
+	for (int32 i = 0; i < HITBOX_NUM; i++) {
+		const float BoxRadius = FVector::Dist(OutCenter, Package.Locations[i]) + Package.BoxExtents[i].Size();
+		OutRadius = FMath::Max(OutRadius, BoxRadius);
 	}
 }
 
@@ -496,16 +321,16 @@ void ULagCompensationComponent::EnableCharacterMeshCollision(
 */
 void ULagCompensationComponent::ShowFramePackage(const FFramePackage& Package,
 	const FColor& Color) {
-	for (const TPair<FName, FBoxInformation>& BoxInfo : Package.HitBoxInfo) {
+	for (int32 i = 0; i < HITBOX_NUM; i++) {
 		/*
 		DrawDebugBox(
 			GetWorld(),
-			BoxInfo.Value.Location,
-			BoxInfo.Value.BoxExtent,
-			FQuat(BoxInfo.Value.Rotation),
+			Package.Locations[i],
+			Package.BoxExtents[i],
+			Package.Rotations[i],
 			Color,
 			false,
-			MaxRecordTime);
+			RewindHistory ? RewindHistory->GetMaxRecordTime() : 1.f);
 			*/
 	}
 }
@@ -530,162 +355,315 @@ void ULagCompensationComponent::ShowFramePackage(const FFramePackage& Package,
 FServerSideRewindResult ULagCompensationComponent::ServerSideRewind(
 	ABlasterCharacter* HitCharacter,
 	const FVector_NetQuantize& TraceStart,
-	const FVector_NetQuantize& HitLocation, float HitTime) {
+	const FVector_NetQuantize& HitLocation, double HitTime) const {
 
 	FFramePackage FrameToCheck = GetFrameToCheck(HitCharacter, HitTime);
+	if (FrameToCheck.Character == nullptr) return FServerSideRewindResult();
 	return ConfirmHit(FrameToCheck, HitCharacter, TraceStart, HitLocation);
 }
 
+/**
+* Finds the first rewound box of any character along the shot, so a shot that
+* the client thinks hit one character but passes through another first counts
+* against whoever was actually in front. The shooter's own boxes are skipped.
+* The tree only picks the character, which is then confirmed exactly like a
+* single character rewind, so the head wins whenever the shot crosses it.
+*
+* @param  Tree Every character's boxes at the time of the shot
+* @param  TraceStart The start of the line trace from where the instigator shot
+* @param  HitLocation Location in world space where there was a hit on the client
+* @param  OutHitCharacter The character that was hit, null if nothing was
+* @return Whether there was a hit or not and whether it was a headshot or not
+*/
+FServerSideRewindResult ULagCompensationComponent::ServerSideRewindAll(const FHitBoxTree& Tree,
+	const FVector_NetQuantize& TraceStart, const FVector_NetQuantize& HitLocation,
+	ABlasterCharacter*& OutHitCharacter) const {
+	OutHitCharacter = nullptr;
+	const FVector TraceEnd = TraceStart + (HitLocation - TraceStart) * 1.25f;
+
+	FHitBoxTreeHit TreeHit;
+	if (!Tree.Raycast(TraceStart, TraceEnd, Character, TreeHit)) {
+		return FServerSideRewindResult{ false, false };
+	}
+	const FServerSideRewindResult Result = ConfirmHit(Tree.GetFrames()[TreeHit.Frame],
+		TreeHit.Character, TraceStart, HitLocation);
+	if (Result.bHitConfirmed) {
+		OutHitCharacter = TreeHit.Character;
+	}
+	return Result;
+}
+
 FServerSideRewindResult ULagCompensationComponent::ProjectileServerSideRewind(
 	ABlasterCharacter* HitCharacter, const FVector_NetQuantize& TraceStart, 
-	const FVector_NetQuantize100& InitialVelocity, float HitTime) {
+	const FVector_NetQuantize100& InitialVelocity, double FireTime) const {
 
-	FFramePackage FrameToCheck = GetFrameToCheck(HitCharacter, HitTime);
-	return ProjectileConfirmHit(FrameToCheck, HitCharacter, TraceStart, InitialVelocity, HitTime);
+	if (HitCharacter == nullptr) return FServerSideRewindResult();
+	return ProjectileConfirmHit(HitCharacter, TraceStart, InitialVelocity, FireTime);
+}
 
+/**
+* Every character near the explosion is read from the same pair of saved ticks
+* in one pass over the history. A character takes damage by how close its
+* nearest box is to the origin, using the same falloff and minimum damage as
+* the engine's radial damage, if nothing in the level is between them.
+*/
+bool ULagCompensationComponent::ExplosionServerSideRewind(const FVector& Origin,
+	const FRadialDamageParams& Params, TArray<FExplosionHit, TInlineAllocator<EXPLOSION_MAX_TARGETS>>& OutHits,
+	TArray<AActor*>& OutJudged) const {
+	FRewindBracket Bracket;
+	if (RewindHistory == nullptr || !RewindHistory->FindBracket(GetClientViewTime(), Bracket)) {
+		return false;
+	}
+	const float MaxRadius = Params.GetMaxRadius();
+
+	// Characters culled by their rewound root were judged out of range too
+	RewindHistory->GetCharactersInBracket(Bracket, OutJudged);
+
+	FMemMark Mark(FMemStack::Get());
+	TArray<FFramePackage, TMemStackAllocator<>> Frames;
+	RewindHistory->GetFramesInRadius(Bracket, Origin, MaxRadius, Frames);
+
+	for (const FFramePackage& Frame : Frames) {
+		float ClosestDistSquared = FMath::Square(MaxRadius);
+		FVector ClosestPoint = Origin;
+		bool bInRange = false;
+		for (int32 i = 0; i < HITBOX_NUM; i++) {
+			const FVector Point = HitBoxMath::ClosestPointOnBox(Origin,
+				Frame.Locations[i], Frame.Rotations[i], Frame.BoxExtents[i]);
+			const float DistSquared = FVector::DistSquared(Point, Origin);
+			if (DistSquared <= ClosestDistSquared) {
+				ClosestDistSquared = DistSquared;
+				ClosestPoint = Point;
+				bInRange = true;
+			}
+		}
+		if (!bInRange || GetUnoccludedTime(Origin, ClosestPoint, Frame.Character) < 1.f) continue;
+
+		if (OutHits.Num() >= EXPLOSION_MAX_TARGETS) {
+			// No room to damage it here, so it's left to the live explosion
+			OutJudged.RemoveSingleSwap(Frame.Character, false);
+			continue;
+		}
 
+		// Like AActor::InternalTakeRadialDamage, anything within the outer
+		// radius takes at least MinimumDamage
+		const float DamageScale = FMath::Max(Params.GetDamageScale(FMath::Sqrt(ClosestDistSquared)), 0.f);
+		FExplosionHit& Hit = OutHits.AddDefaulted_GetRef();
+		Hit.Character = Frame.Character;
+		Hit.Damage = FMath::Lerp(Params.MinimumDamage, Params.BaseDamage, DamageScale);
+	}
+	return true;
 }
 
+/**
+* The client sees other characters about one trip behind the server, so
+* that's how far back its view of the world is.
+*/
+double ULagCompensationComponent::GetClientViewTime() const {
+	const double Now = RewindHistory ? RewindHistory->GetTimestamp() : 0.0;
+	const ABlasterPlayerState* PlayerState = Character ? Character->GetPlayerState<ABlasterPlayerState>() : nullptr;
+	return PlayerState ? Now - PlayerState->GetRoundTrip().GetOneWayTime() : Now;
+}
+
+/**
+* Frames are large, so they go on the calling thread's FMemStack rather than
+* the heap or the stack. The mark frees them when this returns.
+*/
 FShotgunServerSideRewindResult ULagCompensationComponent::ShotgunServerSideRewind(
-	const TArray<ABlasterCharacter*>& HitCharacters,
+	TArrayView<ABlasterCharacter* const> HitCharacters,
 	const FVector_NetQuantize& TraceStart,
-	const TArray<FVector_NetQuantize>& HitLocations, float HitTime) {
+	TArrayView<const FVector_NetQuantize> HitLocations, double HitTime) const {
 
-	TArray<FFramePackage> FramesToCheck;
-	for (ABlasterCharacter* HitCharacter : HitCharacters) {
-		FramesToCheck.Add(GetFrameToCheck(HitCharacter, HitTime));
+	// Every character is read from the same pair of saved ticks
+	FRewindBracket Bracket;
+	if (RewindHistory == nullptr || !RewindHistory->FindBracket(HitTime, Bracket)) {
+		return FShotgunServerSideRewindResult();
+	}
+	FMemMark Mark(FMemStack::Get());
+	TArray<FFramePackage, TMemStackAllocator<>> FramesToCheck;
+	FramesToCheck.SetNum(FMath::Min(HitCharacters.Num(), SHOTGUN_MAX_TARGETS));
+	for (int32 i = 0; i < FramesToCheck.Num(); i++) {
+		if (!RewindHistory->GetFrame(HitCharacters[i], Bracket, FramesToCheck[i])) {
+			return FShotgunServerSideRewindResult();
+		}
+		FramesToCheck[i].Character = HitCharacters[i];
 	}
 	return ShotgunConfirmHit(FramesToCheck, TraceStart, HitLocations);
 }
 
-FFramePackage ULagCompensationComponent::GetFrameToCheck(ABlasterCharacter* HitCharacter, float HitTime) {
-	bool bReturn =
-		HitCharacter == nullptr ||
-		HitCharacter->GetLagCompensation() == nullptr ||
-		HitCharacter->GetLagCompensation()->FrameHistory.GetHead() == nullptr ||
-		HitCharacter->GetLagCompensation()->FrameHistory.GetTail() == nullptr;
-
-	if (bReturn) return FFramePackage();
-
-	// Frame package that we check to verify a hit
+/**
+* Reads HitCharacter's hitboxes at HitTime from the world's rewind history.
+*
+* @param  HitCharacter The character whose history is searched
+* @param  HitTime The time at which a client hit a target on their end
+* @return The saved or interpolated frame at HitTime. Character is left null
+*		  if no frame could be found, e.g. HitTime is older than the history.
+*/
+FFramePackage ULagCompensationComponent::GetFrameToCheck(ABlasterCharacter* HitCharacter, double HitTime) const {
 	FFramePackage FrameToCheck;
-	bool bShouldInterpolate = true;
-	// Frame history of the HitCharacter (character that you shot at).
-	const TDoubleLinkedList<FFramePackage>& History = HitCharacter->GetLagCompensation()->FrameHistory;
-
-	const float OldestHistoryTime = History.GetTail()->GetValue().Time;
-	const float LatestHistoryTime = History.GetHead()->GetValue().Time;
-
-	/**
-	* Checking cases where the frame to check (HitTime) is either the first
-	* or last in the frame history or if it is out of bounds
-	*/
-	if (OldestHistoryTime > HitTime) {
-		// HitTime is beyond the maximum history range, could be too laggy
+	if (RewindHistory == nullptr || HitCharacter == nullptr ||
+		!RewindHistory->GetFrameAtTime(HitCharacter, HitTime, FrameToCheck)) {
 		return FFramePackage();
 	}
-	if (OldestHistoryTime == HitTime) {
-		// Checking edge case
-		FrameToCheck = History.GetTail()->GetValue();
-		bShouldInterpolate = false;
-	}
-	if (LatestHistoryTime <= HitTime) {
-		// HitTime is newer than the latest frame or equal to
-		FrameToCheck = History.GetHead()->GetValue();
-		bShouldInterpolate = false;
-	}
-	
-	TDoubleLinkedList<FFramePackage>::TDoubleLinkedListNode* Younger = History.GetHead();
-	TDoubleLinkedList<FFramePackage>::TDoubleLinkedListNode* Older = Younger;
-	while (Older->GetValue().Time > HitTime) { // Is Older still younger than HitTime?
-		// March back until Oldertime < HitTime < YoungerTime
-		if (Older->GetNextNode() == nullptr) {
-			break;
-		}
-		Older = Older->GetNextNode();
-		if (Older->GetValue().Time > HitTime) {
-			Younger = Older;
-		}
-	}
-	if (Older->GetValue().Time == HitTime) { // Unlikely but needs to be checked
-		FrameToCheck = Older->GetValue();
-		bShouldInterpolate = false;
-	}
-	if (bShouldInterpolate) {
-		// Interpolate between younger and older
-		FrameToCheck = InterpBetweenFrames(Older->GetValue(), Younger->GetValue(), HitTime);
-	}
 	FrameToCheck.Character = HitCharacter;
 	return FrameToCheck;
 }
 
-/**
-*
-*/
-void ULagCompensationComponent::ServerScoreRequest_Implementation(
-	ABlasterCharacter* HitCharacter,
-	const FVector_NetQuantize& TraceStart,
-	const FVector_NetQuantize& HitLocation,
-	float HitTime) {
-
-	FServerSideRewindResult Confirm = ServerSideRewind(HitCharacter, TraceStart,
-		HitLocation, HitTime);
+void ULagCompensationComponent::QueueScoreRequest(ABlasterCharacter* HitCharacter,
+	const FVector_NetQuantize& TraceStart, const FVector_NetQuantize& HitLocation, uint16 Sequence, double HitTime) {
+	FShotReport Report;
+	Report.HitCharacter = HitCharacter;
+	Report.TraceStart = TraceStart;
+	Report.ShotVector = HitLocation;
+	Report.Sequence = Sequence;
+	Report.bProjectile = false;
+	QueueShotReport(Report, HitTime);
+}
 
-	if (Character && HitCharacter && Character->GetEquippedWeapon() && Confirm.bHitConfirmed) {
+void ULagCompensationComponent::QueueProjectileScoreRequest(ABlasterCharacter* HitCharacter,
+	const FVector_NetQuantize& TraceStart, const FVector_NetQuantize100& InitialVelocity, uint16 Sequence,
+	double FireTime) {
+	FShotReport Report;
+	Report.HitCharacter = HitCharacter;
+	Report.TraceStart = TraceStart;
+	Report.ShotVector = InitialVelocity;
+	Report.Sequence = Sequence;
+	Report.bProjectile = true;
+	QueueShotReport(Report, FireTime);
+}
 
+/**
+* Holds on to a report until the end of the frame, waking the component up to
+* send it. A full batch is sent straight away.
+*/
+void ULagCompensationComponent::QueueShotReport(const FShotReport& Report, double Time) {
+	PendingReports.Add(Report);
+	PendingReportTimes.Add(Time);
+	if (PendingReports.Num() >= MAX_SHOT_REPORTS) {
+		SendScoreRequests();
+	} else {
+		SetComponentTickEnabled(true);
+	}
+}
 
-		const float Damage = Confirm.bHeadShot ? \
-			Character->GetEquippedWeapon()->GetHeadShotDamage() : Character->GetEquippedWeapon()->GetDamage();
+/**
+* Sends every queued report in one RPC. The oldest report's time goes out
+* quantized, see NetTime, and the rest as millisecond offsets from it.
+*/
+void ULagCompensationComponent::SendScoreRequests() {
+	if (PendingReports.IsEmpty()) return;
 
-		UGameplayStatics::ApplyDamage(HitCharacter, Damage,
-			Character->Controller, Character->GetEquippedWeapon(), UDamageType::StaticClass());
+	double BaseTime = PendingReportTimes[0];
+	for (double Time : PendingReportTimes) {
+		BaseTime = FMath::Min(BaseTime, Time);
 	}
+	// Offsets are from the quantized base so the server rebuilds the same times
+	const uint16 WireBaseTime = NetTime::Quantize(BaseTime);
+	BaseTime = NetTime::Dequantize(WireBaseTime, BaseTime);
+	for (int32 i = 0; i < PendingReports.Num(); i++) {
+		const int32 OffsetMs = FMath::RoundToInt((PendingReportTimes[i] - BaseTime) * 1000.0);
+		PendingReports[i].TimeOffsetMs = static_cast<uint16>(FMath::Clamp(OffsetMs, 0, MAX_uint16));
+	}
+	ABlasterCharacter* OwnerCharacter = Cast<ABlasterCharacter>(GetOwner());
+	const UCombatComponent* Combat = OwnerCharacter ? OwnerCharacter->GetCombat() : nullptr;
+	ServerScoreRequests(NextReportSequence++, WireBaseTime,
+		Combat ? Combat->GetPendingFireInputs() : TArray<FFireInput>(), PendingReports);
+
+	PendingReports.Reset();
+	PendingReportTimes.Reset();
 }
 
-void ULagCompensationComponent::ProjectileServerScoreRequest_Implementation(
-	ABlasterCharacter* HitCharacter, const FVector_NetQuantize& TraceStart, 
-	const FVector_NetQuantize100& InitialVelocity, float HitTime) {
+/**
+* Queues every hit of a batch for validation at the end of the frame. Batches
+* that arrive with a sequence number the server has already handled are
+* dropped. The batch's fire inputs are fired first, the same way the unreliable
+* ServerFireInputs would have, so a hit whose input was lost or is still on
+* its way isn't dropped for it. A hit is still dropped unless the server fired the shot it claims
+* to come from and hasn't scored that shot yet, and a hitscan hit unless it
+* lies along the shot's scattered ray.
+*/
+void ULagCompensationComponent::ServerScoreRequests_Implementation(uint16 Sequence,
+	uint16 BaseTime, const TArray<FFireInput>& FireInputs, const TArray<FShotReport>& Reports) {
+	if (bReceivedReports && static_cast<int16>(Sequence - LastReportSequence) <= 0) return;
+	bReceivedReports = true;
+	LastReportSequence = Sequence;
 
-	FServerSideRewindResult Confirm = ProjectileServerSideRewind(HitCharacter, 
-		TraceStart, InitialVelocity, HitTime);
+	UHitValidationSubsystem* HitValidation = GetWorld() ? GetWorld()->GetSubsystem<UHitValidationSubsystem>() : nullptr;
+	if (HitValidation == nullptr) return;
 
-	if (Character && HitCharacter && Confirm.bHitConfirmed && Character->GetEquippedWeapon()) {
+	UCombatComponent* Combat = Character ? Character->GetCombat() : nullptr;
+	if (Combat == nullptr) return;
 
-		const float Damage = Confirm.bHeadShot ? 
-			Character->GetEquippedWeapon()->GetHeadShotDamage() : Character->GetEquippedWeapon()->GetDamage();
+	const int32 NumFireInputs = FMath::Min(FireInputs.Num(), MAX_FIRE_INPUTS);
+	for (int32 i = 0; i < NumFireInputs; i++) {
+		Combat->ApplyFireInput(FireInputs[i]);
+	}
 
-		UGameplayStatics::ApplyDamage(HitCharacter, Character->GetEquippedWeapon()->GetDamage(),
-			Character->Controller, Character->GetEquippedWeapon(), UDamageType::StaticClass());
+	const double Base = NetTime::Dequantize(BaseTime, GetWorld()->GetTimeSeconds());
+	const int32 NumReports = FMath::Min(Reports.Num(), MAX_SHOT_REPORTS);
+	for (int32 i = 0; i < NumReports; i++) {
+		const FShotReport& Report = Reports[i];
+		if (Report.HitCharacter == nullptr) continue;
+		if (!Report.bProjectile && !Combat->IsShotOnTarget(Report.Sequence, Report.TraceStart, Report.ShotVector)) {
+			continue;
+		}
+		// Each shot or projectile hits one character, so it scores once
+		if (!Combat->ConsumeFiredShot(Report.Sequence)) continue;
+		HitValidation->QueueShotReport(this, Report, Base + Report.TimeOffsetMs / 1000.0);
 	}
 }
 
 void ULagCompensationComponent::ShotgunServerScoreRequest_Implementation(
 	const TArray<ABlasterCharacter*>& HitCharacters,
-	const FVector_NetQuantize& TraceStart,
-	const TArray<FVector_NetQuantize>& HitLocations, float HitTime) {
+	const FFireInput& Blast, uint16 HitTime) {
+
+	// The blast's fire input is unreliable and may not have made it yet. This
+	// request carries the blast itself, so it fires it instead. A blast can't
+	// score unless the server accepted firing it, and only scores once.
+	UCombatComponent* Combat = Character ? Character->GetCombat() : nullptr;
+	if (Combat == nullptr || !Blast.bShotgun) return;
+	Combat->ApplyFireInput(Blast);
+	if (!Combat->ConsumeFiredShot(Blast.Sequence)) return;
+
+	const FVector_NetQuantize& TraceStart = Blast.TraceStart;
+
+	const AShotgun* Shotgun = Cast<AShotgun>(Character->GetEquippedWeapon());
+	UHitValidationSubsystem* HitValidation = GetWorld() ? GetWorld()->GetSubsystem<UHitValidationSubsystem>() : nullptr;
+	if (Shotgun && HitValidation) {
+		TArray<FVector_NetQuantize, TInlineAllocator<SHOTGUN_MAX_PELLETS>> HitLocations;
+		Shotgun->ShotgunTraceEndWithScatter(TraceStart, Blast.Aim, Combat->GetShotSeed(Blast.Sequence), HitLocations);
+		HitValidation->QueueShotgun(this, HitCharacters, TraceStart, HitLocations,
+			NetTime::Dequantize(HitTime, GetWorld()->GetTimeSeconds()));
+	}
+}
 
-	FShotgunServerSideRewindResult Confirm = ShotgunServerSideRewind(
-		HitCharacters, TraceStart, HitLocations, HitTime);
+/**
+* Applies damage for a request once UHitValidationSubsystem has validated it.
+*/
+void ULagCompensationComponent::ApplyValidatedRequest(const FHitValidationRequest& Request) {
+	if (Character == nullptr || Character->GetEquippedWeapon() == nullptr) return;
+	AWeapon* Weapon = Character->GetEquippedWeapon();
+
+	if (!Request.bShotgun) {
+		if (Request.Report.HitCharacter == nullptr || !Request.Result.bHitConfirmed) return;
+
+		const float Damage = Request.Result.bHeadShot ? Weapon->GetHeadShotDamage() : Weapon->GetDamage();
+		UGameplayStatics::ApplyDamage(Request.Report.HitCharacter, Damage,
+			Character->Controller, Weapon, UDamageType::StaticClass());
+		return;
+	}
+
+	const int32 NumTargets = FMath::Min(Request.HitCharacters.Num(), SHOTGUN_MAX_TARGETS);
+	for (int32 Target = 0; Target < NumTargets; Target++) {
+		ABlasterCharacter* HitCharacter = Request.HitCharacters[Target];
+		if (!IsValid(HitCharacter)) continue;
+
+		const float TotalDamage =
+			Request.ShotgunResult.HeadShots[Target] * Weapon->GetHeadShotDamage() +
+			Request.ShotgunResult.BodyShots[Target] * Weapon->GetDamage();
+		if (TotalDamage <= 0.f) continue;
 
-	for (ABlasterCharacter* HitCharacter : HitCharacters) {
-		if (HitCharacter == nullptr ||
-			HitCharacter->GetEquippedWeapon() == nullptr ||
-			Character == nullptr) {
-			continue;
-		}
-		float TotalDamage = 0.f;
-		if (Confirm.HeadShots.Contains(HitCharacter)) {
-			float HeadShotDamage =
-				Confirm.HeadShots[HitCharacter] * HitCharacter->GetEquippedWeapon()->GetHeadShotDamage();
-			TotalDamage += HeadShotDamage;
-		}
-		if (Confirm.BodyShots.Contains(HitCharacter)) {
-			float BodyShotDamage =
-				Confirm.BodyShots[HitCharacter] * HitCharacter->GetEquippedWeapon()->GetDamage();
-			TotalDamage += BodyShotDamage;
-		}
 		UGameplayStatics::ApplyDamage(HitCharacter, TotalDamage,
-			Character->Controller, HitCharacter->GetEquippedWeapon(),
-			UDamageType::StaticClass());
+			Character->Controller, Weapon, UDamageType::StaticClass());
 	}
-}
\ No newline at end of file
+}
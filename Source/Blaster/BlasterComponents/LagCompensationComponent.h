@@ -4,56 +4,104 @@
 
 #include "CoreMinimal.h"
 #include "Components/ActorComponent.h"
+#include "Blaster/BlasterTypes/HitBox.h"
+#include "Blaster/BlasterTypes/ShotEvent.h"
 #include "LagCompensationComponent.generated.h"
 
+/**
+* Every hitbox of one character at one point in time. Hitbox data is kept as
+* fixed-size arrays indexed by EHitBox so saving, copying and interpolating a
+* frame is a linear pass with no heap allocations.
+*/
 USTRUCT(BlueprintType)
-struct FBoxInformation {
+struct FFramePackage {
 	GENERATED_BODY()
 
 	UPROPERTY()
-	FVector Location;
+	double Time = 0.0;
 
-	UPROPERTY()
-	FRotator Rotation;
+	FVector Locations[HITBOX_NUM];
+
+	FQuat Rotations[HITBOX_NUM];
+
+	FVector BoxExtents[HITBOX_NUM];
 
 	UPROPERTY()
-	FVector BoxExtent;
+	ABlasterCharacter* Character = nullptr;
 };
 
 USTRUCT(BlueprintType)
-struct FFramePackage {
+struct FServerSideRewindResult {
 	GENERATED_BODY()
 
 	UPROPERTY()
-	float Time;
+	bool bHitConfirmed = false;
 
 	UPROPERTY()
-	TMap<FName, FBoxInformation> HitBoxInfo;
-
-	UPROPERTY()
-	ABlasterCharacter* Character;
+	bool bHeadShot = false;
 };
 
-USTRUCT(BlueprintType)
-struct FServerSideRewindResult {
+/**
+* One hitscan or projectile hit the client wants confirmed. Hits from the same
+* frame are sent to the server together in one ServerScoreRequests RPC.
+*/
+USTRUCT()
+struct FShotReport {
 	GENERATED_BODY()
 
 	UPROPERTY()
-	bool bHitConfirmed;
+	ABlasterCharacter* HitCharacter = nullptr;
+
+	UPROPERTY()
+	FVector_NetQuantize TraceStart;
+
+	// HitLocation for hitscan shots, InitialVelocity for projectiles
+	UPROPERTY()
+	FVector_NetQuantize100 ShotVector;
+
+	// Milliseconds after the batch's BaseTime that the shot hit, or for
+	// projectiles, was fired
+	UPROPERTY()
+	uint16 TimeOffsetMs = 0;
+
+	// Sequence number of the fire input the shot came from, see FFireInput
+	UPROPERTY()
+	uint16 Sequence = 0;
 
 	UPROPERTY()
-	bool bHeadShot;
+	bool bProjectile = false;
 };
 
+// Most shot reports the server accepts in one batch
+#define MAX_SHOT_REPORTS 64
+
+// Most characters one shotgun blast is checked against. Any extra characters
+// the client reports are ignored.
+#define SHOTGUN_MAX_TARGETS 8
+
+// Most pellets one shotgun blast can report. Blasts with more are rejected.
+#define SHOTGUN_MAX_PELLETS 32
+
+/**
+* Pellets confirmed on each character of a shotgun blast. Counts are indexed by
+* the character's position in the HitCharacters array the client sent.
+*/
 USTRUCT(BlueprintType)
 struct FShotgunServerSideRewindResult {
 	GENERATED_BODY()
 
-	UPROPERTY()
-	TMap<ABlasterCharacter*, uint32> HeadShots;
+	uint8 HeadShots[SHOTGUN_MAX_TARGETS] = {};
 
-	UPROPERTY()
-	TMap<ABlasterCharacter*, uint32> BodyShots;
+	uint8 BodyShots[SHOTGUN_MAX_TARGETS] = {};
+};
+
+// Most characters one explosion can damage
+#define EXPLOSION_MAX_TARGETS 16
+
+/** Damage one character takes from a rewound explosion */
+struct FExplosionHit {
+	ABlasterCharacter* Character = nullptr;
+	float Damage = 0.f;
 };
 
 UCLASS(ClassGroup = (Custom), meta = (BlueprintSpawnableComponent))
@@ -64,76 +112,121 @@ public:
 
 	ULagCompensationComponent();
 	friend class ABlasterCharacter;
+	friend class URewindHistorySubsystem;
+	friend class UHitValidationSubsystem;
+	friend class FHitBoxTreeConfirmHitTest;
 	virtual void TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) override;
 	void ShowFramePackage(const FFramePackage& Package, const FColor& Color);
 
 	/** Hitscan */
 	FServerSideRewindResult ServerSideRewind(ABlasterCharacter* HitCharacter,
 		const FVector_NetQuantize& TraceStart,
-		const FVector_NetQuantize& HitLocation, float HitTime);
+		const FVector_NetQuantize& HitLocation, double HitTime) const;
+
+	/**
+	* Hitscan, resolved against every character's boxes in Tree rather than only
+	* the one the client says it hit
+	*/
+	FServerSideRewindResult ServerSideRewindAll(const class FHitBoxTree& Tree,
+		const FVector_NetQuantize& TraceStart,
+		const FVector_NetQuantize& HitLocation, ABlasterCharacter*& OutHitCharacter) const;
 
 	/**Projectile */
 	FServerSideRewindResult ProjectileServerSideRewind(ABlasterCharacter* HitCharacter,
 		const FVector_NetQuantize& TraceStart,
-		const FVector_NetQuantize100& InitialVelocity, float HitTime);
+		const FVector_NetQuantize100& InitialVelocity, double FireTime) const;
 
 	/** Shotgun */
 	FShotgunServerSideRewindResult ShotgunServerSideRewind(
-		const TArray<ABlasterCharacter*>& HitCharacters,
+		TArrayView<ABlasterCharacter* const> HitCharacters,
 		const FVector_NetQuantize& TraceStart,
-		const TArray<FVector_NetQuantize>& HitLocations,
-		float HitTime);
-
-	UFUNCTION(Server, Reliable)
-	void ServerScoreRequest(
+		TArrayView<const FVector_NetQuantize> HitLocations,
+		double HitTime) const;
+
+	/**
+	* Explosion, judged against where characters were on this character's
+	* client when the explosion happened, one trip before the server's now.
+	* Only characters are rewound, anything else has to be damaged separately.
+	* Server only.
+	*
+	* @param  Origin Centre of the explosion
+	* @param  Params Damage and falloff of the explosion
+	* @param  OutHits Every character the explosion reaches, with its damage
+	* @param  OutJudged Every character the rewind decided for, hit or not.
+	*		  Characters without history at the time aren't in it and still
+	*		  have to be damaged live.
+	* @return False if there was no history to rewind
+	*/
+	bool ExplosionServerSideRewind(const FVector& Origin, const FRadialDamageParams& Params,
+		TArray<FExplosionHit, TInlineAllocator<EXPLOSION_MAX_TARGETS>>& OutHits,
+		TArray<AActor*>& OutJudged) const;
+
+	/** Queues a hit to be sent to the server with the rest of this frame's hits */
+	void QueueScoreRequest(
 		ABlasterCharacter* HitCharacter,
 		const FVector_NetQuantize& TraceStart,
 		const FVector_NetQuantize& HitLocation,
-		float HitTime);
+		uint16 Sequence,
+		double HitTime);
 
-	UFUNCTION(Server, Reliable)
-	void ProjectileServerScoreRequest(
+	void QueueProjectileScoreRequest(
 		ABlasterCharacter* HitCharacter,
 		const FVector_NetQuantize& TraceStart,
 		const FVector_NetQuantize100& InitialVelocity,
-		float HitTime);
+		uint16 Sequence,
+		double FireTime);
+
+	/**
+	* FireInputs are the shots the client is still waiting on the server to
+	* acknowledge. They go out unreliably, so the batch carries them too and
+	* a hit never arrives before the shot it came from.
+	*/
+	UFUNCTION(Server, Reliable)
+	void ServerScoreRequests(uint16 Sequence, uint16 BaseTime,
+		const TArray<FFireInput>& FireInputs,
+		const TArray<FShotReport>& Reports);
 
+	/** The server regenerates the blast's pellets from its sequence number, see AShotgun */
 	UFUNCTION(Server, Reliable)
 	void ShotgunServerScoreRequest(const TArray<ABlasterCharacter*>& HitCharacters,
-		const FVector_NetQuantize& TraceStart,
-		const TArray<FVector_NetQuantize>& HitLocations,
-		float HitTime);
+		const FFireInput& Blast,
+		uint16 HitTime);
 
 protected:
 	virtual void BeginPlay() override;
-	void SaveFramePackage();
-	void SaveFramePackage(FFramePackage& Package);
-	FFramePackage InterpBetweenFrames(FFramePackage& OlderFrame, FFramePackage& YoungerFrame, float HitTime);
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+	void SendScoreRequests();
+	void QueueShotReport(const FShotReport& Report, double Time);
+	void ApplyValidatedRequest(const struct FHitValidationRequest& Request);
 
-	
+	FFramePackage GetFrameToCheck(ABlasterCharacter* HitCharacter, double HitTime) const;
 
-	void CacheBoxPositions(ABlasterCharacter* HitCharacter, FFramePackage& OutFramePackage);
-	void MoveBoxes(ABlasterCharacter* HitCharacter, const FFramePackage& Package);
-	void ResetHitBoxes(ABlasterCharacter* HitCharacter, const FFramePackage& Package);
-	void EnableCharacterMeshCollision(ABlasterCharacter* HitCharacter, ECollisionEnabled::Type CollisionEnabled);
-	FFramePackage GetFrameToCheck(ABlasterCharacter* HitCharacter, float HitTime);
+	/** Server time whose state this character's client was seeing when it acted */
+	double GetClientViewTime() const;
 
 	/** Hitscan */
 	FServerSideRewindResult ConfirmHit(const FFramePackage& Package,
 		ABlasterCharacter* HitCharacter, const FVector_NetQuantize& TraceStart,
-		const FVector_NetQuantize& HitLocation);
+		const FVector_NetQuantize& HitLocation) const;
+
+	bool TraceHitBoxes(const FFramePackage& Package, const FVector& TraceStart,
+		const FVector& TraceEnd, float& OutHeadTime, float& OutBodyTime) const;
+	float GetUnoccludedTime(const FVector& TraceStart, const FVector& TraceEnd,
+		ABlasterCharacter* HitCharacter) const;
 
 	/** Projectile */
-	FServerSideRewindResult ProjectileConfirmHit(const FFramePackage& Package,
-		ABlasterCharacter* HitCharacter,
+	FServerSideRewindResult ProjectileConfirmHit(ABlasterCharacter* HitCharacter,
 		const FVector_NetQuantize& TraceStart,
-		const FVector_NetQuantize100& InitialVelocity, float HitTime);
+		const FVector_NetQuantize100& InitialVelocity, double FireTime) const;
 
 	/** Shotgun */
 	FShotgunServerSideRewindResult ShotgunConfirmHit(
-		const TArray<FFramePackage>& FramePackages,
+		TArrayView<const FFramePackage> FramePackages,
 		const FVector_NetQuantize& TraceStart,
-		const TArray<FVector_NetQuantize>& HitLocations);
+		TArrayView<const FVector_NetQuantize> HitLocations) const;
+
+	static void GetFrameBounds(const FFramePackage& Package, FVector& OutCenter, float& OutRadius);
 
 private:
 
@@ -143,8 +236,33 @@ private:
 	UPROPERTY()
 	class ABlasterPlayerController* Controller;
 
-	TDoubleLinkedList<FFramePackage> FrameHistory;
+	// Frame history of every character lives in the world's rewind subsystem
+	UPROPERTY()
+	class URewindHistorySubsystem* RewindHistory;
+
+	// Column of the owner in RewindHistory's table, set by the subsystem
+	int32 RewindSlot = INDEX_NONE;
+
+	// Steps per second when replaying a projectile's flight. The victim's
+	// history is sampled once per step.
+	UPROPERTY(EditAnywhere)
+	float ProjectileSimFrequency = 60.f;
 
 	UPROPERTY(EditAnywhere)
-	float MaxRecordTime = 1.f;
+	float ProjectileRadius = 5.f;
+
+	/**
+	* Hit reports
+	*/
+
+	// Reports queued this frame and the time each one is for
+	UPROPERTY()
+	TArray<FShotReport> PendingReports;
+	TArray<double> PendingReportTimes;
+
+	uint16 NextReportSequence = 0;
+
+	// Sequence of the last batch the server handled
+	uint16 LastReportSequence = 0;
+	bool bReceivedReports = false;
 };
\ No newline at end of file
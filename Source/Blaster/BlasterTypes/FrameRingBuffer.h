@@ -0,0 +1,100 @@
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+* Fixed-capacity ring buffer for time-stamped history frames. All frames live in
+* one contiguous allocation made when the buffer is reset, so saving a frame
+* never allocates and evicting the oldest frame is just an index bump.
+*
+* Logical index 0 is the oldest frame and Num() - 1 is the newest. FrameType
+* must have a Time member which increases as frames are added.
+*/
+template<typename FrameType>
+class TFrameRingBuffer {
+public:
+
+	/** Drops every frame and (re)allocates storage for Capacity frames */
+	void Reset(int32 Capacity) {
+		Frames.Reset();
+		Frames.SetNum(FMath::Max(Capacity, 1));
+		Head = 0;
+		Count = 0;
+	}
+
+	/**
+	* Claims the slot after the newest frame and returns it for the caller to
+	* fill. If the buffer is full the oldest frame is overwritten. The slot is
+	* recycled storage, so callers must overwrite every field they rely on.
+	*/
+	FrameType& AddNewest() {
+		check(Frames.Num() > 0);
+		const int32 Slot = (Head + Count) % Frames.Num();
+		if (Count == Frames.Num()) {
+			Head = (Head + 1) % Frames.Num();
+		} else {
+			++Count;
+		}
+		return Frames[Slot];
+	}
+
+	void RemoveOldest() {
+		if (Count == 0) return;
+		Head = (Head + 1) % Frames.Num();
+		--Count;
+	}
+
+	/**
+	* Binary search for the first frame that is younger than Time.
+	*
+	* @return Logical index in the range [0, Num()]. Num() means every frame is
+	*		  at or older than Time.
+	*/
+	int32 FindFirstYoungerThan(double Time) const {
+		int32 Low = 0;
+		int32 High = Count;
+		while (Low < High) {
+			const int32 Mid = Low + (High - Low) / 2;
+			if ((*this)[Mid].Time > Time) {
+				High = Mid;
+			} else {
+				Low = Mid + 1;
+			}
+		}
+		return Low;
+	}
+
+	/**
+	* Index of a frame in the underlying storage. Stays the same for as long as
+	* the frame is in the buffer, so it can be used to key parallel tables.
+	*/
+	FORCEINLINE int32 GetStorageIndex(int32 Index) const {
+		checkSlow(Index >= 0 && Index < Count);
+		return (Head + Index) % Frames.Num();
+	}
+
+	FORCEINLINE const FrameType& operator[](int32 Index) const {
+		checkSlow(Index >= 0 && Index < Count);
+		return Frames[(Head + Index) % Frames.Num()];
+	}
+
+	FORCEINLINE FrameType& operator[](int32 Index) {
+		checkSlow(Index >= 0 && Index < Count);
+		return Frames[(Head + Index) % Frames.Num()];
+	}
+
+	FORCEINLINE const FrameType& Oldest() const { return (*this)[0]; }
+	FORCEINLINE const FrameType& Newest() const { return (*this)[Count - 1]; }
+	FORCEINLINE int32 Num() const { return Count; }
+	FORCEINLINE int32 Capacity() const { return Frames.Num(); }
+	FORCEINLINE bool IsEmpty() const { return Count == 0; }
+
+private:
+
+	TArray<FrameType> Frames;
+
+	// Physical index of the oldest frame
+	int32 Head = 0;
+
+	int32 Count = 0;
+};
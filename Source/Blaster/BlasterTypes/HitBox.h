@@ -0,0 +1,32 @@
+#pragma once
+
+/**
+* Stable indices for the hitboxes every BlasterCharacter creates for server-side
+* rewind. Frame packages store hitbox data in arrays indexed by this enum, so
+* the order here must not depend on anything set up at runtime.
+*/
+UENUM(BlueprintType)
+enum class EHitBox : uint8 {
+	EHB_Head UMETA(DisplayName = "head"),
+	EHB_Pelvis UMETA(DisplayName = "pelvis"),
+	EHB_Spine02 UMETA(DisplayName = "spine_02"),
+	EHB_Spine03 UMETA(DisplayName = "spine_03"),
+	EHB_UpperArmL UMETA(DisplayName = "upperarm_l"),
+	EHB_UpperArmR UMETA(DisplayName = "upperarm_r"),
+	EHB_LowerArmL UMETA(DisplayName = "lowerarm_l"),
+	EHB_LowerArmR UMETA(DisplayName = "lowerarm_r"),
+	EHB_HandL UMETA(DisplayName = "hand_l"),
+	EHB_HandR UMETA(DisplayName = "hand_r"),
+	EHB_Blanket UMETA(DisplayName = "blanket"),
+	EHB_Backpack UMETA(DisplayName = "backpack"),
+	EHB_ThighL UMETA(DisplayName = "thigh_l"),
+	EHB_ThighR UMETA(DisplayName = "thigh_r"),
+	EHB_CalfL UMETA(DisplayName = "calf_l"),
+	EHB_CalfR UMETA(DisplayName = "calf_r"),
+	EHB_FootL UMETA(DisplayName = "foot_l"),
+	EHB_FootR UMETA(DisplayName = "foot_r"),
+	EHB_MAX UMETA(DisplayName = "DefaultMAX")
+};
+
+#define HITBOX_NUM static_cast<int32>(EHitBox::EHB_MAX)
+#define HITBOX_HEAD static_cast<int32>(EHitBox::EHB_Head)
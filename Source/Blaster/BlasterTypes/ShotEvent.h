@@ -0,0 +1,53 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/NetSerialization.h"
+#include "ShotEvent.generated.h"
+
+/**
+* One shot as the firing client sends it to the server. See ShotNet for how
+* the aim and sequence number are used.
+*/
+USTRUCT()
+struct FFireInput {
+	GENERATED_BODY()
+
+	// Muzzle location, only sent for shotgun blasts
+	UPROPERTY()
+	FVector_NetQuantize TraceStart;
+
+	UPROPERTY()
+	uint32 Aim = 0;
+
+	UPROPERTY()
+	uint16 Sequence = 0;
+
+	// Server time the shot was due, see NetTime. Shots due part way through a
+	// frame are stamped with the time they were due rather than the frame's.
+	UPROPERTY()
+	uint16 Time = 0;
+
+	UPROPERTY()
+	bool bShotgun = false;
+};
+
+// Most unacknowledged shots a client keeps resending. Once this many are
+// waiting the client stops firing until the server acknowledges some, since
+// the server only accepts sequence numbers in order. It also accepts no more
+// than this many per packet.
+#define MAX_FIRE_INPUTS 8
+
+/**
+* A shot the server tells a client about. Each client only hears about the
+* shots it could perceive, see UShotEventSubsystem.
+*/
+USTRUCT()
+struct FShotEvent {
+	GENERATED_BODY()
+
+	UPROPERTY()
+	class ABlasterCharacter* Shooter = nullptr;
+
+	UPROPERTY()
+	FFireInput Input;
+};
@@ -102,86 +102,50 @@ ABlasterCharacter::ABlasterCharacter() {
 	* Hit boxes for server-side rewind
 	*/
 
-	head = CreateDefaultSubobject<UBoxComponent>(TEXT("head"));
-	head->SetupAttachment(GetMesh(), FName("head"));
-	HitCollisionBoxes.Add(FName("head"), head);
-
-	pelvis = CreateDefaultSubobject<UBoxComponent>(TEXT("pelvis"));
-	pelvis->SetupAttachment(GetMesh(), FName("pelvis"));
-	HitCollisionBoxes.Add(FName("pelvis"), pelvis);
-
-	spine_02 = CreateDefaultSubobject<UBoxComponent>(TEXT("spine_02"));
-	spine_02->SetupAttachment(GetMesh(), FName("spine_02"));
-	HitCollisionBoxes.Add(FName("spine_02"), spine_02);
-
-	spine_03 = CreateDefaultSubobject<UBoxComponent>(TEXT("spine_03"));
-	spine_03->SetupAttachment(GetMesh(), FName("spine_03"));
-	HitCollisionBoxes.Add(FName("spine_03"), spine_03);
-
-	upperarm_l = CreateDefaultSubobject<UBoxComponent>(TEXT("upperarm_l"));
-	upperarm_l->SetupAttachment(GetMesh(), FName("upperarm_l"));
-	HitCollisionBoxes.Add(FName("upperarm_l"), upperarm_l);
-
-	upperarm_r = CreateDefaultSubobject<UBoxComponent>(TEXT("upperarm_r"));
-	upperarm_r->SetupAttachment(GetMesh(), FName("upperarm_r"));
-	HitCollisionBoxes.Add(FName("upperarm_r"), upperarm_r);
-
-	lowerarm_l = CreateDefaultSubobject<UBoxComponent>(TEXT("lowerarm_l"));
-	lowerarm_l->SetupAttachment(GetMesh(), FName("lowerarm_l"));
-	HitCollisionBoxes.Add(FName("lowerarm_l"), lowerarm_l);
-
-	lowerarm_r = CreateDefaultSubobject<UBoxComponent>(TEXT("lowerarm_r"));
-	lowerarm_r->SetupAttachment(GetMesh(), FName("lowerarm_r"));
-	HitCollisionBoxes.Add(FName("lowerarm_r"), lowerarm_r);
-
-	hand_l = CreateDefaultSubobject<UBoxComponent>(TEXT("hand_l"));
-	hand_l->SetupAttachment(GetMesh(), FName("hand_l"));
-	HitCollisionBoxes.Add(FName("hand_l"), hand_l);
-
-	hand_r = CreateDefaultSubobject<UBoxComponent>(TEXT("hand_r"));
-	hand_r->SetupAttachment(GetMesh(), FName("hand_r"));
-	HitCollisionBoxes.Add(FName("hand_r"), hand_r);
-
-	blanket = CreateDefaultSubobject<UBoxComponent>(TEXT("blanket"));
-	blanket->SetupAttachment(GetMesh(), FName("backpack"));
-	HitCollisionBoxes.Add(FName("blanket"), blanket);
-
-	backpack = CreateDefaultSubobject<UBoxComponent>(TEXT("backpack"));
-	backpack->SetupAttachment(GetMesh(), FName("backpack"));
-	HitCollisionBoxes.Add(FName("backpack"), backpack);
-
-	thigh_l = CreateDefaultSubobject<UBoxComponent>(TEXT("thigh_l"));
-	thigh_l->SetupAttachment(GetMesh(), FName("thigh_l"));
-	HitCollisionBoxes.Add(FName("thigh_l"), thigh_l);
-
-	thigh_r = CreateDefaultSubobject<UBoxComponent>(TEXT("thigh_r"));
-	thigh_r->SetupAttachment(GetMesh(), FName("thigh_r"));
-	HitCollisionBoxes.Add(FName("thigh_r"), thigh_r);
-
-	calf_l = CreateDefaultSubobject<UBoxComponent>(TEXT("calf_l"));
-	calf_l->SetupAttachment(GetMesh(), FName("calf_l"));
-	HitCollisionBoxes.Add(FName("calf_l"), calf_l);
-
-	calf_r = CreateDefaultSubobject<UBoxComponent>(TEXT("calf_r"));
-	calf_r->SetupAttachment(GetMesh(), FName("calf_r"));
-	HitCollisionBoxes.Add(FName("calf_r"), calf_r);
-
-	foot_l = CreateDefaultSubobject<UBoxComponent>(TEXT("foot_l"));
-	foot_l->SetupAttachment(GetMesh(), FName("foot_l"));
-	HitCollisionBoxes.Add(FName("foot_l"), foot_l);
-
-	foot_r = CreateDefaultSubobject<UBoxComponent>(TEXT("foot_r"));
-	foot_r->SetupAttachment(GetMesh(), FName("foot_r"));
-	HitCollisionBoxes.Add(FName("foot_r"), foot_r);
-
-	for (auto Box : HitCollisionBoxes) {
-		if (Box.Value) {
-			Box.Value->SetCollisionObjectType(ECC_HitBox);
-			Box.Value->SetCollisionResponseToAllChannels(ECollisionResponse::ECR_Ignore);
-			Box.Value->SetCollisionResponseToChannel(ECC_HitBox, ECollisionResponse::ECR_Block);
-			Box.Value->SetCollisionEnabled(ECollisionEnabled::NoCollision);
-		}
-	}
+	HitCollisionBoxes.SetNumZeroed(HITBOX_NUM);
+
+	head = CreateHitBox(EHitBox::EHB_Head, FName("head"), FName("head"));
+	pelvis = CreateHitBox(EHitBox::EHB_Pelvis, FName("pelvis"), FName("pelvis"));
+	spine_02 = CreateHitBox(EHitBox::EHB_Spine02, FName("spine_02"), FName("spine_02"));
+	spine_03 = CreateHitBox(EHitBox::EHB_Spine03, FName("spine_03"), FName("spine_03"));
+	upperarm_l = CreateHitBox(EHitBox::EHB_UpperArmL, FName("upperarm_l"), FName("upperarm_l"));
+	upperarm_r = CreateHitBox(EHitBox::EHB_UpperArmR, FName("upperarm_r"), FName("upperarm_r"));
+	lowerarm_l = CreateHitBox(EHitBox::EHB_LowerArmL, FName("lowerarm_l"), FName("lowerarm_l"));
+	lowerarm_r = CreateHitBox(EHitBox::EHB_LowerArmR, FName("lowerarm_r"), FName("lowerarm_r"));
+	hand_l = CreateHitBox(EHitBox::EHB_HandL, FName("hand_l"), FName("hand_l"));
+	hand_r = CreateHitBox(EHitBox::EHB_HandR, FName("hand_r"), FName("hand_r"));
+	blanket = CreateHitBox(EHitBox::EHB_Blanket, FName("blanket"), FName("backpack"));
+	backpack = CreateHitBox(EHitBox::EHB_Backpack, FName("backpack"), FName("backpack"));
+	thigh_l = CreateHitBox(EHitBox::EHB_ThighL, FName("thigh_l"), FName("thigh_l"));
+	thigh_r = CreateHitBox(EHitBox::EHB_ThighR, FName("thigh_r"), FName("thigh_r"));
+	calf_l = CreateHitBox(EHitBox::EHB_CalfL, FName("calf_l"), FName("calf_l"));
+	calf_r = CreateHitBox(EHitBox::EHB_CalfR, FName("calf_r"), FName("calf_r"));
+	foot_l = CreateHitBox(EHitBox::EHB_FootL, FName("foot_l"), FName("foot_l"));
+	foot_r = CreateHitBox(EHitBox::EHB_FootR, FName("foot_r"), FName("foot_r"));
+}
+
+/**
+* Creates one server-side rewind hitbox attached to BoneName and registers it
+* at its fixed EHitBox index. The box is only where its bone, offset and size
+* are authored. The rewind history reads them once when the character
+* registers and answers every query from its own copy, so the box never has
+* collision and never touches the physics scene.
+*
+* @param  HitBox Index of the hitbox in HitCollisionBoxes and in frame packages
+* @param  BoxName Name of the box subobject
+* @param  BoneName Bone (or socket) of the mesh the box is attached to
+* @return The created box
+*/
+UBoxComponent* ABlasterCharacter::CreateHitBox(EHitBox HitBox, FName BoxName, FName BoneName) {
+	UBoxComponent* Box = CreateDefaultSubobject<UBoxComponent>(BoxName);
+	Box->SetupAttachment(GetMesh(), BoneName);
+	Box->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+	Box->SetCollisionResponseToAllChannels(ECollisionResponse::ECR_Ignore);
+	Box->SetGenerateOverlapEvents(false);
+	Box->SetCanEverAffectNavigation(false);
+	Box->CanCharacterStepUpOn = ECanBeCharacterBase::ECB_No;
+	HitCollisionBoxes[static_cast<int32>(HitBox)] = Box;
+	return Box;
 }
 
 void ABlasterCharacter::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const {
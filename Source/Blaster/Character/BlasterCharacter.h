@@ -10,6 +10,7 @@
 #include "Components/TimelineComponent.h"
 #include "Blaster/BlasterTypes/CombatState.h"
 #include "Blaster/BlasterTypes/Team.h"
+#include "Blaster/BlasterTypes/HitBox.h"
 #include "BlasterCharacter.generated.h"
 
 DECLARE_DYNAMIC_MULTICAST_DELEGATE(FOnLeftGame);
@@ -69,8 +70,10 @@ public:
 	void UpdateHUDAmmo();
 	void SpawnDefaultWeapon();
 
+	// Hitboxes for server-side rewind, indexed by EHitBox. Layout only, they
+	// never have collision.
 	UPROPERTY()
-	TMap<FName, class UBoxComponent*> HitCollisionBoxes;
+	TArray<class UBoxComponent*> HitCollisionBoxes;
 
 	bool bFinishedSwapping = false;
 
@@ -157,6 +160,8 @@ protected:
 	void DropOrDestroyWeapon(AWeapon* Weapon);
 	void DropOrDestroyWeapons();
 
+	UBoxComponent* CreateHitBox(EHitBox HitBox, FName BoxName, FName BoneName);
+
 	/**
 	* Hitboxes used for server-side rewind.
 	*/
@@ -441,6 +446,7 @@ public:
 	FORCEINLINE UStaticMeshComponent* GetAttachedGrenande() const { return AttachedGrenade; }
 	FORCEINLINE UBuffComponent* GetBuff() const { return BuffComponent; }
 	FORCEINLINE ULagCompensationComponent* GetLagCompensation() const { return LagCompensation; }
+	FORCEINLINE UBoxComponent* GetHitBox(EHitBox HitBox) const { return HitCollisionBoxes[static_cast<int32>(HitBox)]; }
 	FORCEINLINE bool IsHoldingTheFlag() const;
 	bool IsLocallyReloading();
 	ETeam GetTeam();
@@ -0,0 +1,84 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "ClockSync.h"
+#include "Algo/Sort.h"
+
+namespace {
+	// A sample is trusted if its round trip is within this much of the best
+	// one in the window
+	constexpr double TrustedRoundTripRatio = 1.5;
+	constexpr double TrustedRoundTripSlack = 0.005;
+
+	// Clocks on the same machine class don't drift by more than this, so a
+	// steeper fitted line is noise
+	constexpr double MaxDrift = 0.001;
+}
+
+FClockSync::FClockSync() {
+	Samples.Reset(WindowSize);
+}
+
+void FClockSync::AddSample(double ClientSendTime, double ServerTime, double ClientReceiveTime) {
+	const double RoundTrip = ClientReceiveTime - ClientSendTime;
+	if (RoundTrip < 0.0) return;
+
+	FClockSample& Sample = Samples.AddNewest();
+	Sample.Time = ClientReceiveTime;
+	Sample.RoundTrip = RoundTrip;
+	Sample.Offset = ServerTime + 0.5 * RoundTrip - ClientReceiveTime;
+
+	UpdateEstimate();
+}
+
+double FClockSync::GetServerTime(double ClientTime) const {
+	return ClientTime + BaseOffset + Drift * (ClientTime - BaseTime);
+}
+
+/**
+* Keeps only the samples whose round trip is close to the best in the window,
+* then fits offset against time through them by least squares.
+*/
+void FClockSync::UpdateEstimate() {
+	double RoundTrips[WindowSize];
+	double MinRoundTrip = TNumericLimits<double>::Max();
+	for (int32 i = 0; i < Samples.Num(); i++) {
+		RoundTrips[i] = Samples[i].RoundTrip;
+		MinRoundTrip = FMath::Min(MinRoundTrip, RoundTrips[i]);
+	}
+	Algo::Sort(MakeArrayView(RoundTrips, Samples.Num()));
+	SingleTripTime = 0.5 * RoundTrips[Samples.Num() / 2];
+
+	const double MaxTrustedRoundTrip = MinRoundTrip * TrustedRoundTripRatio + TrustedRoundTripSlack;
+	int32 NumTrusted = 0;
+	double MeanTime = 0.0;
+	double MeanOffset = 0.0;
+	for (int32 i = 0; i < Samples.Num(); i++) {
+		if (Samples[i].RoundTrip > MaxTrustedRoundTrip) continue;
+		MeanTime += Samples[i].Time;
+		MeanOffset += Samples[i].Offset;
+		++NumTrusted;
+	}
+	MeanTime /= NumTrusted;
+	MeanOffset /= NumTrusted;
+
+	double Covariance = 0.0;
+	double Variance = 0.0;
+	for (int32 i = 0; i < Samples.Num(); i++) {
+		if (Samples[i].RoundTrip > MaxTrustedRoundTrip) continue;
+		const double DeltaTime = Samples[i].Time - MeanTime;
+		Covariance += DeltaTime * (Samples[i].Offset - MeanOffset);
+		Variance += DeltaTime * DeltaTime;
+	}
+	BaseTime = MeanTime;
+	BaseOffset = MeanOffset;
+	Drift = NumTrusted > 1 && Variance > UE_DOUBLE_SMALL_NUMBER ?
+		FMath::Clamp(Covariance / Variance, -MaxDrift, MaxDrift) : 0.0;
+
+	double WorstResidual = 0.0;
+	for (int32 i = 0; i < Samples.Num(); i++) {
+		if (Samples[i].RoundTrip > MaxTrustedRoundTrip) continue;
+		const double Predicted = BaseOffset + Drift * (Samples[i].Time - BaseTime);
+		WorstResidual = FMath::Max(WorstResidual, FMath::Abs(Samples[i].Offset - Predicted));
+	}
+	Uncertainty = 0.5 * MinRoundTrip + WorstResidual;
+}
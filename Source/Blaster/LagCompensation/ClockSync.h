@@ -0,0 +1,71 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Blaster/BlasterTypes/FrameRingBuffer.h"
+
+/**
+* Client side estimate of the server's clock, built from a window of time sync
+* round trips the same way NTP filters its peers. The round trips with the
+* lowest delay are the ones least disturbed by queueing, so only samples close
+* to the window's minimum round trip are trusted for the offset. A line fitted
+* through them gives the drift between the two clocks, and how well they fit
+* is how confident the estimate is.
+*/
+class FClockSync {
+public:
+
+	FClockSync();
+
+	/**
+	* Adds one round trip.
+	*
+	* @param ClientSendTime Client time the request was sent
+	* @param ServerTime Server time the request arrived
+	* @param ClientReceiveTime Client time the reply arrived
+	*/
+	void AddSample(double ClientSendTime, double ServerTime, double ClientReceiveTime);
+
+	/** Server time at the given client time, 0 offset until there are samples */
+	double GetServerTime(double ClientTime) const;
+
+	/** Typical one way trip, half the window's median round trip */
+	FORCEINLINE double GetSingleTripTime() const { return SingleTripTime; }
+
+	/**
+	* Rough bound on how far GetServerTime could be off, in seconds. Half the
+	* best round trip, since that's as far as an asymmetric route can skew it,
+	* plus how far the trusted samples stray from the fitted line.
+	*/
+	FORCEINLINE double GetUncertainty() const { return Uncertainty; }
+
+	FORCEINLINE double GetDrift() const { return Drift; }
+	FORCEINLINE int32 NumSamples() const { return Samples.Num(); }
+	FORCEINLINE bool IsWindowFull() const { return Samples.Num() == Samples.Capacity(); }
+
+private:
+
+	void UpdateEstimate();
+
+	struct FClockSample {
+		// Client time the reply arrived
+		double Time = 0.0;
+		double RoundTrip = 0.0;
+
+		// Server minus client time, assuming both legs took as long
+		double Offset = 0.0;
+	};
+
+	TFrameRingBuffer<FClockSample> Samples;
+
+	// Offset = BaseOffset + Drift * (ClientTime - BaseTime)
+	double BaseTime = 0.0;
+	double BaseOffset = 0.0;
+	double Drift = 0.0;
+
+	double SingleTripTime = 0.0;
+	double Uncertainty = 0.0;
+
+	static constexpr int32 WindowSize = 16;
+};
@@ -0,0 +1,132 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "HitBoxMath.h"
+#include "Math/VectorRegister.h"
+#include "HAL/IConsoleManager.h"
+#include "Blaster/BlasterTypes/HitBox.h"
+
+/**
+* Slab test in the box's local space. The segment is clipped against the pair
+* of planes on each axis, and it hits the box if the clipped range is not empty.
+*/
+bool HitBoxMath::SegmentIntersectsBox(const FVector& Start, const FVector& End,
+	const FVector& BoxCenter, const FQuat& BoxRotation, const FVector& BoxExtent,
+	float& OutTime) {
+	const FVector LocalStart = BoxRotation.UnrotateVector(Start - BoxCenter);
+	const FVector LocalDelta = BoxRotation.UnrotateVector(End - Start);
+
+	double EnterTime = 0.0;
+	double ExitTime = 1.0;
+	for (int32 Axis = 0; Axis < 3; Axis++) {
+		const double StartOnAxis = LocalStart[Axis];
+		const double DeltaOnAxis = LocalDelta[Axis];
+		const double ExtentOnAxis = BoxExtent[Axis];
+
+		if (FMath::Abs(DeltaOnAxis) < UE_SMALL_NUMBER) {
+			// Parallel to this slab, so it has to start inside it
+			if (StartOnAxis < -ExtentOnAxis || StartOnAxis > ExtentOnAxis) {
+				return false;
+			}
+			continue;
+		}
+		const double InvDelta = 1.0 / DeltaOnAxis;
+		double NearTime = (-ExtentOnAxis - StartOnAxis) * InvDelta;
+		double FarTime = (ExtentOnAxis - StartOnAxis) * InvDelta;
+		if (NearTime > FarTime) {
+			Swap(NearTime, FarTime);
+		}
+		EnterTime = FMath::Max(EnterTime, NearTime);
+		ExitTime = FMath::Min(ExitTime, FarTime);
+		if (EnterTime > ExitTime) {
+			return false;
+		}
+	}
+	OutTime = static_cast<float>(EnterTime);
+	return true;
+}
+
+FVector HitBoxMath::ClosestPointOnBox(const FVector& Point,
+	const FVector& BoxCenter, const FQuat& BoxRotation, const FVector& BoxExtent) {
+	const FVector LocalPoint = BoxRotation.UnrotateVector(Point - BoxCenter);
+	const FVector Clamped = LocalPoint.BoundToBox(-BoxExtent, BoxExtent);
+	return BoxCenter + BoxRotation.RotateVector(Clamped);
+}
+
+void HitBoxMath::InterpHitBoxes(const FVector* OlderLocations, const FQuat* OlderRotations,
+	const FVector* YoungerLocations, const FQuat* YoungerRotations,
+	int32 Num, float Alpha, FVector* OutLocations, FQuat* OutRotations) {
+	const VectorRegister4Double VAlpha = VectorSetFloat1((double)Alpha);
+	const VectorRegister4Double VZero = VectorSetFloat1(0.0);
+	const VectorRegister4Double VOne = VectorSetFloat1(1.0);
+	const VectorRegister4Double VMinusOne = VectorSetFloat1(-1.0);
+
+	for (int32 i = 0; i < Num; i++) {
+		const VectorRegister4Double OlderLocation = VectorLoadFloat3(&OlderLocations[i].X);
+		const VectorRegister4Double YoungerLocation = VectorLoadFloat3(&YoungerLocations[i].X);
+		VectorStoreFloat3(VectorMultiplyAdd(VectorSubtract(YoungerLocation, OlderLocation), VAlpha, OlderLocation),
+			&OutLocations[i].X);
+
+		// q and -q are the same rotation, flip the younger one onto the older
+		// one's side so the blend takes the short way round
+		const VectorRegister4Double OlderRotation = VectorLoad(&OlderRotations[i].X);
+		VectorRegister4Double YoungerRotation = VectorLoad(&YoungerRotations[i].X);
+		const VectorRegister4Double Bias = VectorSelect(
+			VectorCompareGE(VectorDot4(OlderRotation, YoungerRotation), VZero), VOne, VMinusOne);
+		YoungerRotation = VectorMultiply(YoungerRotation, Bias);
+
+		const VectorRegister4Double Blended = VectorMultiplyAdd(
+			VectorSubtract(YoungerRotation, OlderRotation), VAlpha, OlderRotation);
+		VectorStore(VectorNormalizeQuaternion(Blended), &OutRotations[i].X);
+	}
+}
+
+#if !UE_BUILD_SHIPPING
+
+/**
+* Times the interpolation kernel against the scalar Lerp and Slerp it replaced,
+* at a few hitbox counts. Usage: Blaster.BenchmarkHitBoxInterp [Iterations]
+*/
+static FAutoConsoleCommand BenchmarkHitBoxInterpCommand(
+	TEXT("Blaster.BenchmarkHitBoxInterp"),
+	TEXT("Times rewound hitbox interpolation per query at several hitbox counts"),
+	FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& Args) {
+		const int32 Iterations = Args.Num() > 0 ? FMath::Max(FCString::Atoi(*Args[0]), 1) : 100000;
+
+		FRandomStream Stream(1234);
+		FVector OlderLocations[HITBOX_NUM], YoungerLocations[HITBOX_NUM], OutLocations[HITBOX_NUM];
+		FQuat OlderRotations[HITBOX_NUM], YoungerRotations[HITBOX_NUM], OutRotations[HITBOX_NUM];
+		for (int32 i = 0; i < HITBOX_NUM; i++) {
+			OlderLocations[i] = Stream.VRand() * 100.f;
+			YoungerLocations[i] = OlderLocations[i] + Stream.VRand() * 5.f;
+			OlderRotations[i] = FQuat(Stream.VRand(), Stream.FRandRange(-PI, PI));
+			YoungerRotations[i] = OlderRotations[i] * FQuat(Stream.VRand(), 0.1f);
+		}
+
+		const int32 Counts[] = { 1, 4, 8, HITBOX_NUM };
+		for (const int32 Num : Counts) {
+			uint64 StartCycles = FPlatformTime::Cycles64();
+			for (int32 Iteration = 0; Iteration < Iterations; Iteration++) {
+				const float Alpha = (Iteration & 255) / 255.f;
+				for (int32 i = 0; i < Num; i++) {
+					OutLocations[i] = FMath::Lerp(OlderLocations[i], YoungerLocations[i], Alpha);
+					OutRotations[i] = FQuat::Slerp(OlderRotations[i], YoungerRotations[i], Alpha);
+				}
+			}
+			const double ScalarSeconds = FPlatformTime::ToSeconds64(FPlatformTime::Cycles64() - StartCycles);
+
+			StartCycles = FPlatformTime::Cycles64();
+			for (int32 Iteration = 0; Iteration < Iterations; Iteration++) {
+				const float Alpha = (Iteration & 255) / 255.f;
+				InterpHitBoxes(OlderLocations, OlderRotations, YoungerLocations, YoungerRotations,
+					Num, Alpha, OutLocations, OutRotations);
+			}
+			const double KernelSeconds = FPlatformTime::ToSeconds64(FPlatformTime::Cycles64() - StartCycles);
+
+			UE_LOG(LogTemp, Display, TEXT("HitBox interp, %2d boxes: scalar %.1f ns, kernel %.1f ns per query"),
+				Num, ScalarSeconds * 1e9 / Iterations, KernelSeconds * 1e9 / Iterations);
+		}
+		// Keeps the loops from being optimized away
+		UE_LOG(LogTemp, Verbose, TEXT("%s %s"), *OutLocations[0].ToString(), *OutRotations[0].ToString());
+	}));
+
+#endif
@@ -0,0 +1,46 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+* Geometry used to confirm hits against rewound hitboxes analytically, so a
+* server-side rewind never has to move boxes or touch the physics scene.
+*/
+namespace HitBoxMath {
+
+	/**
+	* Intersects the segment Start -> End with an oriented box.
+	*
+	* @param  Start Segment start in world space
+	* @param  End Segment end in world space
+	* @param  BoxCenter Centre of the box in world space
+	* @param  BoxRotation Orientation of the box in world space
+	* @param  BoxExtent Half size of the box along each of its local axes
+	* @param  OutTime Fraction along the segment where it enters the box, 0 if
+	*		  Start is already inside
+	* @return Whether the segment touches the box
+	*/
+	bool SegmentIntersectsBox(const FVector& Start, const FVector& End,
+		const FVector& BoxCenter, const FQuat& BoxRotation, const FVector& BoxExtent,
+		float& OutTime);
+
+	/** Point on or inside an oriented box that is closest to Point */
+	FVector ClosestPointOnBox(const FVector& Point,
+		const FVector& BoxCenter, const FQuat& BoxRotation, const FVector& BoxExtent);
+
+	/**
+	* Interpolates Num hitboxes between two poses in one pass. Locations are
+	* lerped and rotations are normalized lerps along the shortest path, four
+	* components at a time in vector registers. Saved samples are close enough
+	* together that nlerp is indistinguishable from slerp.
+	*
+	* @param  Alpha How far from the older to the younger pose, 0 to 1
+	* @param  OutLocations Caller owned, room for Num locations. May alias either input.
+	* @param  OutRotations Caller owned, room for Num rotations. May alias either input.
+	*/
+	void InterpHitBoxes(const FVector* OlderLocations, const FQuat* OlderRotations,
+		const FVector* YoungerLocations, const FQuat* YoungerRotations,
+		int32 Num, float Alpha, FVector* OutLocations, FQuat* OutRotations);
+}
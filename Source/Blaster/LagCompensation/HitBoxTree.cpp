@@ -0,0 +1,126 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "HitBoxTree.h"
+#include "HitBoxMath.h"
+#include "RewindHistorySubsystem.h"
+#include "Algo/Sort.h"
+
+void FHitBoxTree::Build(const URewindHistorySubsystem& RewindHistory, const FRewindBracket& Bracket) {
+	Frames.Reset();
+	RewindHistory.GetAllFrames(Bracket, Frames);
+	BuildBoxes();
+}
+
+void FHitBoxTree::Build(TArrayView<const FFramePackage> InFrames) {
+	Frames.Reset();
+	Frames.Append(InFrames.GetData(), InFrames.Num());
+	BuildBoxes();
+}
+
+void FHitBoxTree::BuildBoxes() {
+	Boxes.Reset(Frames.Num() * HITBOX_NUM);
+	Nodes.Reset();
+
+	for (int32 Frame = 0; Frame < Frames.Num(); Frame++) {
+		const FFramePackage& Package = Frames[Frame];
+		for (int32 i = 0; i < HITBOX_NUM; i++) {
+			// Bounds of an oriented box are the sum of its rotated extents
+			const FQuat& Rotation = Package.Rotations[i];
+			const FVector& Extent = Package.BoxExtents[i];
+			const FVector WorldExtent =
+				(Rotation.GetAxisX() * Extent.X).GetAbs() +
+				(Rotation.GetAxisY() * Extent.Y).GetAbs() +
+				(Rotation.GetAxisZ() * Extent.Z).GetAbs();
+
+			FBoxRef& Box = Boxes.AddDefaulted_GetRef();
+			Box.Frame = Frame;
+			Box.HitBox = i;
+			Box.Bounds = FBox::BuildAABB(Package.Locations[i], WorldExtent);
+		}
+	}
+	if (Boxes.IsEmpty()) return;
+
+	// Leaves hold at least two boxes, so there are never more nodes than boxes
+	Nodes.Reserve(Boxes.Num());
+	Nodes.AddDefaulted();
+	BuildNode(0, 0, Boxes.Num());
+}
+
+/**
+* Top down build. Boxes are split in half by the centre of their bounds along
+* the axis those centres are most spread out on.
+*/
+void FHitBoxTree::BuildNode(int32 NodeIndex, int32 FirstBox, int32 NumBoxes) {
+	FBox Bounds(ForceInit);
+	FBox Centers(ForceInit);
+	for (int32 i = FirstBox; i < FirstBox + NumBoxes; i++) {
+		Bounds += Boxes[i].Bounds;
+		Centers += Boxes[i].Bounds.GetCenter();
+	}
+	Nodes[NodeIndex].Bounds = Bounds;
+
+	if (NumBoxes <= MaxLeafBoxes) {
+		Nodes[NodeIndex].FirstBox = FirstBox;
+		Nodes[NodeIndex].NumBoxes = NumBoxes;
+		return;
+	}
+
+	const FVector Spread = Centers.GetSize();
+	const int32 Axis = Spread.X >= Spread.Y && Spread.X >= Spread.Z ? 0 : (Spread.Y >= Spread.Z ? 1 : 2);
+	Algo::Sort(MakeArrayView(Boxes.GetData() + FirstBox, NumBoxes), [Axis](const FBoxRef& A, const FBoxRef& B) {
+		return A.Bounds.GetCenter()[Axis] < B.Bounds.GetCenter()[Axis];
+	});
+
+	// Children are added together so an inner node only needs the first index
+	const int32 FirstChild = Nodes.AddDefaulted(2);
+	Nodes[NodeIndex].FirstBox = FirstChild;
+	Nodes[NodeIndex].NumBoxes = 0;
+
+	const int32 Half = NumBoxes / 2;
+	BuildNode(FirstChild, FirstBox, Half);
+	BuildNode(FirstChild + 1, FirstBox + Half, NumBoxes - Half);
+}
+
+/**
+* Walks every node the segment passes through. Once a box is hit, the segment
+* is shortened to end there, so nodes further along are skipped.
+*/
+bool FHitBoxTree::Raycast(const FVector& Start, const FVector& End,
+	const ABlasterCharacter* IgnoreCharacter, FHitBoxTreeHit& OutHit) const {
+	OutHit = FHitBoxTreeHit();
+	if (Nodes.IsEmpty()) return false;
+
+	const FVector Delta = End - Start;
+	bool bHit = false;
+
+	TArray<int32, TInlineAllocator<64, FHitValidationAllocator>> Stack;
+	Stack.Push(0);
+	while (!Stack.IsEmpty()) {
+		const FNode& Node = Nodes[Stack.Pop(false)];
+		const FVector ClippedEnd = Start + Delta * OutHit.Time;
+		if (!FMath::LineBoxIntersection(Node.Bounds, Start, ClippedEnd, ClippedEnd - Start)) continue;
+
+		if (Node.NumBoxes == 0) {
+			Stack.Push(Node.FirstBox);
+			Stack.Push(Node.FirstBox + 1);
+			continue;
+		}
+		for (int32 i = Node.FirstBox; i < Node.FirstBox + Node.NumBoxes; i++) {
+			const FBoxRef& Box = Boxes[i];
+			const FFramePackage& Frame = Frames[Box.Frame];
+			if (Frame.Character == IgnoreCharacter) continue;
+
+			float EnterTime;
+			const bool bBoxHit = HitBoxMath::SegmentIntersectsBox(Start, End,
+				Frame.Locations[Box.HitBox], Frame.Rotations[Box.HitBox], Frame.BoxExtents[Box.HitBox], EnterTime);
+			if (bBoxHit && (!bHit || EnterTime < OutHit.Time)) {
+				bHit = true;
+				OutHit.Character = Frame.Character;
+				OutHit.HitBox = Box.HitBox;
+				OutHit.Frame = Box.Frame;
+				OutHit.Time = EnterTime;
+			}
+		}
+	}
+	return bHit;
+}
@@ -0,0 +1,84 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Blaster/BlasterComponents/LagCompensationComponent.h"
+#include "HitValidationAllocator.h"
+
+class ABlasterCharacter;
+class URewindHistorySubsystem;
+struct FRewindBracket;
+
+struct FHitBoxTreeHit {
+	ABlasterCharacter* Character = nullptr;
+
+	// EHitBox index of the box that was hit
+	int32 HitBox = INDEX_NONE;
+
+	// Index of the character's frame in GetFrames()
+	int32 Frame = INDEX_NONE;
+
+	// Fraction along the segment where it enters the box
+	float Time = 1.f;
+};
+
+/**
+* Bounding volume hierarchy over the rewound hitboxes of every character at
+* one point in time. Lets the server find the first box a shot actually hits
+* out of everyone, rather than only testing the character the client named.
+* Rebuilding a tree reuses its storage, so a tree kept around between frames
+* stops allocating once it has seen the largest frame. Any allocation it does
+* make is counted by FHitValidationAllocationScope.
+*/
+class FHitBoxTree {
+public:
+
+	/** Rebuilds the tree from every character's rewound frame at the bracket's time */
+	void Build(const URewindHistorySubsystem& RewindHistory, const FRewindBracket& Bracket);
+
+	/** Rebuilds the tree from frames that were already rewound */
+	void Build(TArrayView<const FFramePackage> InFrames);
+
+	/**
+	* Finds the first box the segment Start -> End enters.
+	*
+	* @param  IgnoreCharacter A character whose boxes are skipped, usually the shooter
+	* @param  OutHit The closest hit
+	* @return Whether any box was hit
+	*/
+	bool Raycast(const FVector& Start, const FVector& End,
+		const ABlasterCharacter* IgnoreCharacter, FHitBoxTreeHit& OutHit) const;
+
+	FORCEINLINE const TArray<FFramePackage, FHitValidationAllocator>& GetFrames() const { return Frames; }
+
+private:
+
+	struct FBoxRef {
+		int32 Frame = 0;
+		int32 HitBox = 0;
+
+		// World space bounds of the oriented box
+		FBox Bounds;
+	};
+
+	struct FNode {
+		FBox Bounds;
+
+		// Leaves own Boxes[FirstBox, FirstBox + NumBoxes). Inner nodes have
+		// NumBoxes == 0 and their children at FirstBox and FirstBox + 1.
+		int32 FirstBox = 0;
+		int32 NumBoxes = 0;
+	};
+
+	void BuildBoxes();
+	void BuildNode(int32 NodeIndex, int32 FirstBox, int32 NumBoxes);
+
+	TArray<FFramePackage, FHitValidationAllocator> Frames;
+	TArray<FBoxRef, FHitValidationAllocator> Boxes;
+
+	// Root at index 0
+	TArray<FNode, FHitValidationAllocator> Nodes;
+
+	static constexpr int32 MaxLeafBoxes = 4;
+};
@@ -0,0 +1,22 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "HitValidationAllocator.h"
+
+namespace {
+	thread_local FThreadSafeCounter* CurrentAllocationCounter = nullptr;
+}
+
+FHitValidationAllocationScope::FHitValidationAllocationScope(FThreadSafeCounter& InCounter)
+	: Previous(CurrentAllocationCounter) {
+	CurrentAllocationCounter = &InCounter;
+}
+
+FHitValidationAllocationScope::~FHitValidationAllocationScope() {
+	CurrentAllocationCounter = Previous;
+}
+
+void FHitValidationAllocationScope::Record() {
+	if (CurrentAllocationCounter) {
+		CurrentAllocationCounter->Increment();
+	}
+}
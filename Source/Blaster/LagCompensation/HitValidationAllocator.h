@@ -0,0 +1,68 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+* While one of these is open, every heap allocation made on the same thread by
+* a container using FHitValidationAllocator is counted into its counter.
+* Scopes nest, the innermost one counts. Each thread opens its own, so
+* allocations made by other threads in the meantime are never counted.
+*/
+class FHitValidationAllocationScope {
+public:
+
+	explicit FHitValidationAllocationScope(FThreadSafeCounter& InCounter);
+	~FHitValidationAllocationScope();
+
+	/** Counts one allocation against the thread's open scope, if there is one */
+	static void Record();
+
+private:
+
+	FThreadSafeCounter* Previous;
+};
+
+/**
+* Heap allocator for the containers the hit validation pass uses, directly or
+* as the secondary of an inline allocator. Allocates exactly like
+* FHeapAllocator, but every time it has to go to the heap it is recorded
+* against the thread's FHitValidationAllocationScope.
+*/
+class FHitValidationAllocator : public FHeapAllocator {
+public:
+
+	class ForAnyElementType : public FHeapAllocator::ForAnyElementType {
+	public:
+
+		FORCEINLINE void ResizeAllocation(SizeType CurrentNum, SizeType NewMax, SIZE_T NumBytesPerElement) {
+			if (NewMax > 0) {
+				FHitValidationAllocationScope::Record();
+			}
+			FHeapAllocator::ForAnyElementType::ResizeAllocation(CurrentNum, NewMax, NumBytesPerElement);
+		}
+
+		FORCEINLINE void ResizeAllocation(SizeType CurrentNum, SizeType NewMax, SIZE_T NumBytesPerElement,
+			uint32 AlignmentOfElement) {
+			if (NewMax > 0) {
+				FHitValidationAllocationScope::Record();
+			}
+			FHeapAllocator::ForAnyElementType::ResizeAllocation(CurrentNum, NewMax, NumBytesPerElement,
+				AlignmentOfElement);
+		}
+	};
+
+	template<typename ElementType>
+	class ForElementType : public ForAnyElementType {
+	public:
+
+		FORCEINLINE ElementType* GetAllocation() const {
+			return (ElementType*)ForAnyElementType::GetAllocation();
+		}
+	};
+};
+
+template<>
+struct TAllocatorTraits<FHitValidationAllocator> : TAllocatorTraits<FHeapAllocator> {
+};
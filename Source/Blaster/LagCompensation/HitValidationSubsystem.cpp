@@ -0,0 +1,366 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "HitValidationSubsystem.h"
+#include "Async/ParallelFor.h"
+#include "HAL/LowLevelMemTracker.h"
+#include "Blaster/Character/BlasterCharacter.h"
+#include "RewindHistorySubsystem.h"
+#include "Blaster/PlayerState/BlasterPlayerState.h"
+
+DECLARE_STATS_GROUP(TEXT("HitValidation"), STATGROUP_HitValidation, STATCAT_Advanced);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Received"), STAT_HitValidationReceived, STATGROUP_HitValidation);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Rejected Implausible"), STAT_HitValidationImplausible, STATGROUP_HitValidation);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Rejected Broadphase"), STAT_HitValidationBroadphase, STATGROUP_HitValidation);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Rewound"), STAT_HitValidationRewound, STATGROUP_HitValidation);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Confirmed"), STAT_HitValidationConfirmed, STATGROUP_HitValidation);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Allocations"), STAT_HitValidationAllocations, STATGROUP_HitValidation);
+
+// Anything the validation pass allocates is tracked under this tag when the
+// engine runs with -llm, on whichever thread it happens
+LLM_DEFINE_TAG(HitValidation);
+
+void UHitValidationSubsystem::Initialize(FSubsystemCollectionBase& Collection) {
+	Super::Initialize(Collection);
+
+	RewindHistory = Collection.InitializeDependency<URewindHistorySubsystem>();
+}
+
+bool UHitValidationSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const {
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+TStatId UHitValidationSubsystem::GetStatId() const {
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UHitValidationSubsystem, STATGROUP_Tickables);
+}
+
+bool UHitValidationSubsystem::IsTickable() const {
+	return !Requests.IsEmpty();
+}
+
+void UHitValidationSubsystem::Tick(float DeltaTime) {
+	Super::Tick(DeltaTime);
+
+	FlushRequests();
+}
+
+void UHitValidationSubsystem::QueueShotReport(ULagCompensationComponent* Shooter,
+	const FShotReport& Report, double Time) {
+	Stats.Received.Increment();
+	INC_DWORD_STAT(STAT_HitValidationReceived);
+
+	const bool bInRange = Report.bProjectile ||
+		FVector::DistSquared(Report.TraceStart, Report.ShotVector) <= FMath::Square(MaxHitScanRange + MaxTraceStartDistance);
+	if (Shooter == nullptr || !bInRange ||
+		!IsPlausible(*Shooter, Report.TraceStart, Time, Report.bProjectile) ||
+		(!Report.bProjectile && !IsAimPlausible(*Shooter, Report.TraceStart, Report.ShotVector))) {
+		Stats.RejectedImplausible.Increment();
+		INC_DWORD_STAT(STAT_HitValidationImplausible);
+		return;
+	}
+
+	FHitValidationRequest& Request = Requests.AddDefaulted_GetRef();
+	Request.Shooter = Shooter;
+	Request.Report = Report;
+	Request.Time = Time;
+}
+
+void UHitValidationSubsystem::QueueShotgun(ULagCompensationComponent* Shooter,
+	const TArray<ABlasterCharacter*>& HitCharacters,
+	const FVector_NetQuantize& TraceStart,
+	TArrayView<const FVector_NetQuantize> HitLocations,
+	double HitTime) {
+	Stats.Received.Increment();
+	INC_DWORD_STAT(STAT_HitValidationReceived);
+
+	bool bPlausible = Shooter && HitLocations.Num() <= SHOTGUN_MAX_PELLETS &&
+		IsPlausible(*Shooter, TraceStart, HitTime, false);
+	for (int32 i = 0; bPlausible && i < HitLocations.Num(); i++) {
+		bPlausible =
+			FVector::DistSquared(TraceStart, HitLocations[i]) <= FMath::Square(MaxHitScanRange + MaxTraceStartDistance) &&
+			IsAimPlausible(*Shooter, TraceStart, HitLocations[i]);
+	}
+	if (!bPlausible) {
+		Stats.RejectedImplausible.Increment();
+		INC_DWORD_STAT(STAT_HitValidationImplausible);
+		return;
+	}
+
+	FHitValidationRequest& Request = Requests.AddDefaulted_GetRef();
+	Request.Shooter = Shooter;
+	Request.bShotgun = true;
+	Request.HitCharacters.Append(HitCharacters.GetData(), FMath::Min(HitCharacters.Num(), SHOTGUN_MAX_TARGETS));
+	Request.Report.TraceStart = TraceStart;
+	Request.HitLocations.Append(HitLocations.GetData(), HitLocations.Num());
+	Request.Time = HitTime;
+}
+
+/**
+* Constant time checks that a shot could have come from this shooter at this
+* time, before anything is rewound.
+*
+* @param  Shooter The lag compensation component of the character that fired
+* @param  TraceStart Where the client says the shot started
+* @param  Time The client's rewind time for the shot
+* @param  bProjectile Projectile times are when the shot was fired, so they
+*		  can also be older by however long the projectile flew
+* @return False if the shot should be rejected without being rewound
+*/
+bool UHitValidationSubsystem::IsPlausible(const ULagCompensationComponent& Shooter,
+	const FVector& TraceStart, double Time, bool bProjectile) const {
+	const ABlasterCharacter* ShooterCharacter = Shooter.Character;
+	if (ShooterCharacter == nullptr || RewindHistory == nullptr) return false;
+
+	if (FVector::DistSquared(TraceStart, ShooterCharacter->GetActorLocation()) > FMath::Square(MaxTraceStartDistance)) {
+		return false;
+	}
+
+	// Has to be inside the history, and not from the future. A projectile can
+	// have been fired before the oldest saved tick and still hit inside it.
+	const double Now = RewindHistory->GetTimestamp();
+	if ((!bProjectile && Time < RewindHistory->GetOldestTime()) || Time > Now + RewindTimeTolerance) {
+		return false;
+	}
+
+	// Can't be much older than the shooter's connection allows for
+	const ABlasterPlayerState* PlayerState = ShooterCharacter->GetPlayerState<ABlasterPlayerState>();
+	float MaxAge = (PlayerState ? PlayerState->GetRoundTrip().GetRewindWindow() : 0.f) + RewindTimeTolerance;
+	if (bProjectile) {
+		MaxAge += RewindHistory->GetMaxRecordTime();
+	}
+	return Now - Time <= MaxAge;
+}
+
+bool UHitValidationSubsystem::IsAimPlausible(const ULagCompensationComponent& Shooter,
+	const FVector& TraceStart, const FVector& Target) const {
+	const ABlasterCharacter* ShooterCharacter = Shooter.Character;
+	if (ShooterCharacter == nullptr) return false;
+
+	const FVector AimDirection = ShooterCharacter->GetBaseAimRotation().Vector();
+	const FVector ShotDirection = (Target - TraceStart).GetSafeNormal();
+	return FVector::DotProduct(AimDirection, ShotDirection) >= FMath::Cos(FMath::DegreesToRadians(MaxAimAngle));
+}
+
+/**
+* Tests a request against spheres around its targets' rewound roots. Only the
+* roots are read from the history, so this is far cheaper than a rewind.
+*	- Hitscan: the shot against the character the client says it hit
+*	- Shotgun: each character against every pellet. Characters no pellet
+*	  passes near are dropped from the request.
+*	- Projectile: the flight path, a few chords at a time, against where the
+*	  character moved over each chord
+*
+* @return False if the request can't hit anything and shouldn't be rewound
+*/
+bool UHitValidationSubsystem::PassesBroadphase(FHitValidationRequest& Request) const {
+	if (RewindHistory == nullptr) return false;
+	const FShotReport& Report = Request.Report;
+
+	if (Request.bShotgun) {
+		FRewindBracket Bracket;
+		if (!RewindHistory->FindBracket(Request.Time, Bracket)) return false;
+
+		for (int32 Target = Request.HitCharacters.Num() - 1; Target >= 0; Target--) {
+			FVector RootLocation;
+			bool bNearPellet = false;
+			if (RewindHistory->GetRootLocation(Request.HitCharacters[Target], Bracket, RootLocation)) {
+				for (int32 i = 0; !bNearPellet && i < Request.HitLocations.Num(); i++) {
+					bNearPellet = ShotPassesRoot(Report.TraceStart, Request.HitLocations[i], RootLocation);
+				}
+			}
+			if (!bNearPellet) {
+				Request.HitCharacters.RemoveAt(Target);
+			}
+		}
+		return !Request.HitCharacters.IsEmpty();
+	}
+
+	if (Report.HitCharacter == nullptr) return false;
+
+	if (Report.bProjectile) {
+		const UWorld* World = GetWorld();
+		if (World == nullptr) return false;
+
+		// The projectile can't have flown for longer than since it was fired
+		const FVector Gravity(0.f, 0.f, World->GetGravityZ());
+		const float FlightTime = FMath::Clamp(static_cast<float>(RewindHistory->GetTimestamp() - Request.Time),
+			0.f, RewindHistory->GetMaxRecordTime());
+		const float ChordTime = FlightTime / PROJECTILE_BROADPHASE_CHORDS;
+
+		// How far the arc bows away from each straight chord
+		const float ChordSag = FMath::Abs(Gravity.Z) * ChordTime * ChordTime / 8.f;
+
+		FVector ChordStart = Report.TraceStart;
+		FVector RootStart;
+		bool bHasRootStart = false;
+		FRewindBracket Bracket;
+		if (RewindHistory->FindBracket(Request.Time, Bracket)) {
+			bHasRootStart = RewindHistory->GetRootLocation(Report.HitCharacter, Bracket, RootStart);
+		}
+		for (int32 Chord = 1; Chord <= PROJECTILE_BROADPHASE_CHORDS; Chord++) {
+			const float SimTime = ChordTime * Chord;
+			const FVector ChordEnd = FVector(Report.TraceStart) + Report.ShotVector * SimTime + 0.5f * Gravity * SimTime * SimTime;
+			FVector RootEnd;
+			const bool bHasRootEnd = RewindHistory->FindBracket(Request.Time + SimTime, Bracket) &&
+				RewindHistory->GetRootLocation(Report.HitCharacter, Bracket, RootEnd);
+
+			// The projectile was still in flight before the history starts
+			if (bHasRootEnd) {
+				FVector ClosestOnChord;
+				FVector ClosestOnRootPath;
+				FMath::SegmentDistToSegmentSafe(ChordStart, ChordEnd, bHasRootStart ? RootStart : RootEnd, RootEnd,
+					ClosestOnChord, ClosestOnRootPath);
+				if (FVector::DistSquared(ClosestOnChord, ClosestOnRootPath) <= FMath::Square(RootBoundsRadius + ChordSag)) {
+					return true;
+				}
+			}
+			ChordStart = ChordEnd;
+			RootStart = RootEnd;
+			bHasRootStart = bHasRootEnd;
+		}
+		return false;
+	}
+
+	FRewindBracket Bracket;
+	FVector RootLocation;
+	return RewindHistory->FindBracket(Request.Time, Bracket) &&
+		RewindHistory->GetRootLocation(Report.HitCharacter, Bracket, RootLocation) &&
+		ShotPassesRoot(Report.TraceStart, Report.ShotVector, RootLocation);
+}
+
+/** Whether a trace, lengthened a little for the client's error, passes near a character's root */
+bool UHitValidationSubsystem::ShotPassesRoot(const FVector& TraceStart, const FVector& HitLocation,
+	const FVector& RootLocation) const {
+	const FVector TraceEnd = TraceStart + (HitLocation - TraceStart) * 1.25f;
+	const FVector ClosestPoint = FMath::ClosestPointOnSegment(RootLocation, TraceStart, TraceEnd);
+	return FVector::DistSquared(ClosestPoint, RootLocation) <= FMath::Square(RootBoundsRadius);
+}
+
+/**
+* Anything that could have been destroyed since its request was queued is
+* checked on the game thread first, so the parallel pass only touches objects
+* that stay alive until it is done. Every request is then tested against its
+* targets' rewound roots, and only the ones that pass get trees built for them
+* or are rewound. Nothing in the validation pass should need
+* the heap: requests hold their arrays inline, trees reuse last frame's
+* storage, and rewound frames go on each thread's FMemStack. Every container
+* the pass uses counts its heap allocations into the pass's total, and with
+* -llm their bytes show up under the HitValidation tag.
+*/
+void UHitValidationSubsystem::FlushRequests() {
+	if (Requests.IsEmpty()) return;
+
+	FThreadSafeCounter Allocations;
+	TArray<ULagCompensationComponent*, TInlineAllocator<64, FHitValidationAllocator>> Shooters;
+	{
+		FHitValidationAllocationScope AllocationScope(Allocations);
+
+		Shooters.SetNumZeroed(Requests.Num());
+		for (int32 i = 0; i < Requests.Num(); i++) {
+			FHitValidationRequest& Request = Requests[i];
+			Shooters[i] = Request.Shooter.Get();
+			if (!IsValid(Request.Report.HitCharacter)) {
+				Request.Report.HitCharacter = nullptr;
+			}
+			for (ABlasterCharacter*& HitCharacter : Request.HitCharacters) {
+				if (!IsValid(HitCharacter)) {
+					HitCharacter = nullptr;
+				}
+			}
+
+			Request.bPassedBroadphase = Shooters[i] && PassesBroadphase(Request);
+			if (!Request.bPassedBroadphase) {
+				Stats.RejectedBroadphase.Increment();
+				INC_DWORD_STAT(STAT_HitValidationBroadphase);
+			}
+		}
+
+		if (bResolveHitScanAgainstAllCharacters) {
+			BuildHitBoxTrees(Allocations);
+		}
+
+		ParallelFor(Requests.Num(), [this, &Shooters, &Allocations](int32 Index) {
+			FHitValidationAllocationScope WorkerAllocationScope(Allocations);
+			if (Shooters[Index] && Requests[Index].bPassedBroadphase) {
+				ValidateRequest(*Shooters[Index], Requests[Index]);
+			}
+		}, Requests.Num() < MinParallelRequests);
+	}
+	Stats.Allocations.Add(Allocations.GetValue());
+	INC_DWORD_STAT_BY(STAT_HitValidationAllocations, Allocations.GetValue());
+
+	// Damage can kill and destroy characters, so it goes back on the game thread
+	// in the order the requests came in
+	for (int32 i = 0; i < Requests.Num(); i++) {
+		if (IsValid(Shooters[i])) {
+			Shooters[i]->ApplyValidatedRequest(Requests[i]);
+		}
+	}
+	Requests.Reset();
+	NumHitBoxTrees = 0;
+}
+
+/**
+* Builds one tree per distinct millisecond that hitscan requests which passed
+* the broadphase were fired at, in parallel, and points each request at its tree.
+*/
+void UHitValidationSubsystem::BuildHitBoxTrees(FThreadSafeCounter& Allocations) {
+	if (RewindHistory == nullptr) return;
+
+	// Only a handful of distinct times per frame, so a linear search beats a map
+	TArray<int64, TInlineAllocator<16, FHitValidationAllocator>> TreeMs;
+	TArray<FRewindBracket, TInlineAllocator<16, FHitValidationAllocator>> Brackets;
+	for (FHitValidationRequest& Request : Requests) {
+		if (!Request.bPassedBroadphase || Request.bShotgun || Request.Report.bProjectile) continue;
+
+		const int64 Ms = FMath::RoundToInt64(Request.Time * 1000.0);
+		Request.TreeIndex = TreeMs.Find(Ms);
+		if (Request.TreeIndex != INDEX_NONE) continue;
+
+		FRewindBracket Bracket;
+		if (!RewindHistory->FindBracket(Request.Time, Bracket)) continue;
+
+		Request.TreeIndex = Brackets.Add(Bracket);
+		TreeMs.Add(Ms);
+	}
+
+	NumHitBoxTrees = Brackets.Num();
+	if (HitBoxTrees.Num() < NumHitBoxTrees) {
+		HitBoxTrees.SetNum(NumHitBoxTrees);
+	}
+	ParallelFor(NumHitBoxTrees, [this, &Brackets, &Allocations](int32 Index) {
+		LLM_SCOPE_BYTAG(HitValidation);
+		FHitValidationAllocationScope WorkerAllocationScope(Allocations);
+		HitBoxTrees[Index].Build(*RewindHistory, Brackets[Index]);
+	}, NumHitBoxTrees < 2);
+}
+
+void UHitValidationSubsystem::ValidateRequest(const ULagCompensationComponent& Shooter,
+	FHitValidationRequest& Request) {
+	LLM_SCOPE_BYTAG(HitValidation);
+	FShotReport& Report = Request.Report;
+	const bool bUseTree = Request.TreeIndex != INDEX_NONE && Request.TreeIndex < NumHitBoxTrees;
+	Stats.Rewound.Increment();
+	INC_DWORD_STAT(STAT_HitValidationRewound);
+
+	bool bConfirmed = false;
+	if (Request.bShotgun) {
+		Request.ShotgunResult = Shooter.ShotgunServerSideRewind(Request.HitCharacters,
+			Report.TraceStart, Request.HitLocations, Request.Time);
+		for (int32 i = 0; i < SHOTGUN_MAX_TARGETS; i++) {
+			bConfirmed |= Request.ShotgunResult.HeadShots[i] > 0 || Request.ShotgunResult.BodyShots[i] > 0;
+		}
+	} else if (bUseTree) {
+		Request.Result = Shooter.ServerSideRewindAll(HitBoxTrees[Request.TreeIndex],
+			Report.TraceStart, Report.ShotVector, Report.HitCharacter);
+		bConfirmed = Request.Result.bHitConfirmed;
+	} else {
+		Request.Result = Report.bProjectile ?
+			Shooter.ProjectileServerSideRewind(Report.HitCharacter, Report.TraceStart, Report.ShotVector, Request.Time) :
+			Shooter.ServerSideRewind(Report.HitCharacter, Report.TraceStart, Report.ShotVector, Request.Time);
+		bConfirmed = Request.Result.bHitConfirmed;
+	}
+	if (bConfirmed) {
+		Stats.Confirmed.Increment();
+		INC_DWORD_STAT(STAT_HitValidationConfirmed);
+	}
+}
@@ -0,0 +1,169 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Blaster/BlasterComponents/LagCompensationComponent.h"
+#include "HitBoxTree.h"
+#include "HitValidationAllocator.h"
+#include "Blaster/Weapon/WeaponTypes.h"
+#include "HitValidationSubsystem.generated.h"
+
+class ABlasterCharacter;
+
+// Straight pieces a projectile's flight is split into for the broadphase
+#define PROJECTILE_BROADPHASE_CHORDS 4
+
+/**
+* A hit a client asked the server to confirm, waiting for the end of the frame
+* to be validated with every other hit received that frame.
+*/
+struct FHitValidationRequest {
+	TWeakObjectPtr<ULagCompensationComponent> Shooter;
+
+	// Hitscan or projectile hit. If the hitscan shot is resolved against every
+	// character, HitCharacter is replaced with whoever it actually hit.
+	FShotReport Report;
+	double Time = 0.0;
+
+	// Tree of every character's boxes at Time, for resolving hitscan shots
+	int32 TreeIndex = INDEX_NONE;
+
+	// Shotgun blast, validated instead of Report when bShotgun is set
+	bool bShotgun = false;
+	TArray<ABlasterCharacter*, TInlineAllocator<SHOTGUN_MAX_TARGETS>> HitCharacters;
+	TArray<FVector_NetQuantize, TInlineAllocator<SHOTGUN_MAX_PELLETS>> HitLocations;
+
+	// Filled in by the validation pass
+	bool bPassedBroadphase = false;
+	FServerSideRewindResult Result;
+	FShotgunServerSideRewindResult ShotgunResult;
+};
+
+/**
+* How many requests each stage of validation has seen. Requests rejected by an
+* earlier, cheaper stage never reach the later ones, so the gap between
+* Received and Rewound is rewind work that was avoided.
+*/
+struct FHitValidationStats {
+	FThreadSafeCounter Received;
+
+	// Failed a constant time check when the request arrived
+	FThreadSafeCounter RejectedImplausible;
+
+	// Shot didn't pass near any target's rewound root
+	FThreadSafeCounter RejectedBroadphase;
+
+	// Needed a full rewind against the target's boxes
+	FThreadSafeCounter Rewound;
+
+	FThreadSafeCounter Confirmed;
+
+	// Heap allocations the validation passes made, counted on every thread
+	// that took part. Validation shouldn't make any once its reused storage
+	// has grown to fit, so anything steadily above zero is worth a look.
+	FThreadSafeCounter Allocations;
+};
+
+/**
+* Server-side queue of hits waiting for lag compensated validation. Once a
+* frame every queued hit is validated in parallel across worker threads, which
+* only read the rewind history and run scene queries against the level, both
+* safe once physics has finished for the frame. Damage is then applied on
+* the game thread in the order the hits were received.
+*
+* Validation is tiered so most bad requests are turned away cheaply:
+*	1. Constant time plausibility checks when the request arrives
+*	2. The shot against a sphere around each target's rewound root
+*	3. The full rewind against the target's boxes
+*/
+UCLASS(Config = Game)
+class BLASTER_API UHitValidationSubsystem : public UTickableWorldSubsystem {
+	GENERATED_BODY()
+
+public:
+
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+	virtual bool IsTickable() const override;
+
+	void QueueShotReport(ULagCompensationComponent* Shooter, const FShotReport& Report, double Time);
+	void QueueShotgun(ULagCompensationComponent* Shooter,
+		const TArray<ABlasterCharacter*>& HitCharacters,
+		const FVector_NetQuantize& TraceStart,
+		TArrayView<const FVector_NetQuantize> HitLocations,
+		double HitTime);
+
+	/** Validates and applies everything queued so far */
+	void FlushRequests();
+
+	FORCEINLINE const FHitValidationStats& GetStats() const { return Stats; }
+
+protected:
+
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+private:
+
+	void ValidateRequest(const ULagCompensationComponent& Shooter, FHitValidationRequest& Request);
+	void BuildHitBoxTrees(FThreadSafeCounter& Allocations);
+
+	bool IsPlausible(const ULagCompensationComponent& Shooter, const FVector& TraceStart, double Time,
+		bool bProjectile) const;
+	bool IsAimPlausible(const ULagCompensationComponent& Shooter, const FVector& TraceStart,
+		const FVector& Target) const;
+	bool PassesBroadphase(FHitValidationRequest& Request) const;
+	bool ShotPassesRoot(const FVector& TraceStart, const FVector& HitLocation, const FVector& RootLocation) const;
+
+	FHitValidationStats Stats;
+
+	UPROPERTY()
+	class URewindHistorySubsystem* RewindHistory;
+
+	TArray<FHitValidationRequest> Requests;
+
+	// Built only for times hitscan requests this frame ask about, and shared by
+	// every request for the same millisecond. Trees are kept between frames so
+	// their storage is reused, only the first NumHitBoxTrees are current.
+	TArray<FHitBoxTree, FHitValidationAllocator> HitBoxTrees;
+	int32 NumHitBoxTrees = 0;
+
+	// Resolve hitscan shots against every character's rewound boxes instead of
+	// only the character the client says it hit
+	UPROPERTY(Config)
+	bool bResolveHitScanAgainstAllCharacters = true;
+
+	/**
+	* Plausibility limits
+	*/
+
+	// Furthest a shot can start from the shooter's current location. Covers the
+	// muzzle offset plus how far the shooter can move during the round trip.
+	UPROPERTY(Config)
+	float MaxTraceStartDistance = 400.f;
+
+	// How much older than the shooter's rewind window a rewind can be, and how
+	// far in the future it can be, in seconds. Clients filter their clock sync,
+	// so this only has to cover a few frames of error.
+	UPROPERTY(Config)
+	float RewindTimeTolerance = 0.05f;
+
+	// Largest angle between the shooter's current aim and a hitscan shot, in
+	// degrees. Projectiles aren't checked, the shooter may have turned while
+	// one was in flight.
+	UPROPERTY(Config)
+	float MaxAimAngle = 45.f;
+
+	UPROPERTY(Config)
+	float MaxHitScanRange = TRACE_LENGTH;
+
+	// Radius around a character's root that contains all of its hitboxes
+	UPROPERTY(Config)
+	float RootBoundsRadius = 150.f;
+
+	// Below this many requests, validation isn't worth spreading over threads
+	UPROPERTY(Config)
+	int32 MinParallelRequests = 4;
+};
@@ -0,0 +1,24 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "NetTime.h"
+
+namespace {
+	constexpr int64 EpochMs = 1 << 16;
+}
+
+uint16 NetTime::Quantize(double Time) {
+	return static_cast<uint16>(FMath::RoundToInt64(Time * 1000.0) & (EpochMs - 1));
+}
+
+double NetTime::Dequantize(uint16 WireTime, double ReferenceTime) {
+	const int64 ReferenceMs = FMath::RoundToInt64(ReferenceTime * 1000.0);
+	int64 TimeMs = (ReferenceMs & ~(EpochMs - 1)) | WireTime;
+
+	// Could be in the epoch either side of the reference's
+	if (TimeMs - ReferenceMs > EpochMs / 2) {
+		TimeMs -= EpochMs;
+	} else if (ReferenceMs - TimeMs > EpochMs / 2) {
+		TimeMs += EpochMs;
+	}
+	return TimeMs / 1000.0;
+}
@@ -0,0 +1,29 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+* Server times as they are sent over the network. Times are doubles everywhere
+* else, since a float of world time is only good to a few milliseconds once a
+* server has been up for a day. A double is twice the size of a float on the
+* wire though, so times are sent as whole milliseconds within an epoch of 2^16
+* ms, about 65 seconds. Rather than sending the epoch, the receiver picks
+* whichever epoch puts the time closest to its own clock. Every time sent is
+* within a few seconds of now, so the epoch in effect rebases itself.
+*/
+namespace NetTime {
+
+	uint16 Quantize(double Time);
+
+	/**
+	* Rebuilds a quantized time.
+	*
+	* @param  WireTime Time as it came off the wire
+	* @param  ReferenceTime The receiver's idea of now. Has to be within about
+	*		  32 seconds of the original time.
+	* @return The original time, to the nearest millisecond
+	*/
+	double Dequantize(uint16 WireTime, double ReferenceTime);
+}
@@ -0,0 +1,167 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "PoseSnapshot.h"
+#include "Blaster/BlasterComponents/LagCompensationComponent.h"
+#include "Blaster/Character/BlasterCharacter.h"
+#include "Components/BoxComponent.h"
+#include "Components/SkeletalMeshComponent.h"
+#include "Engine/SkeletalMeshSocket.h"
+
+namespace {
+	// Each of the three smallest components of a unit quaternion is within
+	// +-1/sqrt(2), stored in 10 bits
+	constexpr float QuatComponentRange = UE_INV_SQRT_2;
+	constexpr uint32 QuatComponentMax = (1 << 10) - 1;
+
+	uint32 QuantizeQuatComponent(float Value) {
+		const float Normalized = (FMath::Clamp(Value, -QuatComponentRange, QuatComponentRange) + QuatComponentRange) /
+			(2.f * QuatComponentRange);
+		return static_cast<uint32>(FMath::RoundToInt(Normalized * QuatComponentMax));
+	}
+
+	float DequantizeQuatComponent(uint32 Value) {
+		return static_cast<float>(Value) / QuatComponentMax * (2.f * QuatComponentRange) - QuatComponentRange;
+	}
+}
+
+void FHitBoxRig::Build(const ABlasterCharacter* Character) {
+	NumBones = 0;
+	BoundsRadius = 0.f;
+	const USkeletalMeshComponent* Mesh = Character->GetMesh();
+	MeshScale = Mesh->GetComponentScale();
+	MeshToActor = Character->GetActorLocation() - Mesh->GetComponentLocation();
+
+	for (int32 i = 0; i < HITBOX_NUM; i++) {
+		const UBoxComponent* Box = Character->HitCollisionBoxes[i];
+		BoxBones[i] = INDEX_NONE;
+		BoxToBone[i] = FTransform::Identity;
+		BoxExtents[i] = Box ? Box->GetScaledBoxExtent() : FVector::ZeroVector;
+		if (Box == nullptr) continue;
+
+		const float BoxReach = FVector::Dist(Box->GetComponentLocation(), Character->GetActorLocation()) +
+			BoxExtents[i].Size();
+		BoundsRadius = FMath::Max(BoundsRadius, BoxReach * 1.25f);
+
+		// Boxes on a socket hang off the socket's bone, offset by the socket
+		const FName AttachName = Box->GetAttachSocketName();
+		FTransform SocketToBone = FTransform::Identity;
+		int32 BoneIndex = Mesh->GetBoneIndex(AttachName);
+		if (BoneIndex == INDEX_NONE) {
+			if (const USkeletalMeshSocket* Socket = Mesh->GetSocketByName(AttachName)) {
+				BoneIndex = Mesh->GetBoneIndex(Socket->BoneName);
+				SocketToBone = Socket->GetSocketLocalTransform();
+			}
+		}
+		if (BoneIndex == INDEX_NONE) {
+			if (AttachName != NAME_None) {
+				UE_LOG(LogTemp, Warning, TEXT("Hitbox %s is attached to %s, which isn't a bone or socket of %s"),
+					*Box->GetName(), *AttachName.ToString(), *Character->GetName());
+			}
+			// Rewound as if it were fixed to the mesh where it is now
+			BoxToBone[i] = Box->GetRelativeTransform();
+			continue;
+		}
+
+		int32 Bone = 0;
+		while (Bone < NumBones && BoneIndices[Bone] != BoneIndex) {
+			Bone++;
+		}
+		if (Bone == NumBones) {
+			BoneIndices[NumBones++] = BoneIndex;
+		}
+		BoxBones[i] = Bone;
+		BoxToBone[i] = Box->GetRelativeTransform() * SocketToBone;
+	}
+}
+
+void FPoseSnapshot::Save(const FHitBoxRig& Rig, const USkeletalMeshComponent& Mesh) {
+	const FTransform& MeshTransform = Mesh.GetComponentTransform();
+	MeshLocation = FVector3f(MeshTransform.GetLocation());
+	MeshRotation = CompressRotation(MeshTransform.GetRotation());
+
+	const TArray<FTransform>& BoneTransforms = Mesh.GetComponentSpaceTransforms();
+	for (int32 Bone = 0; Bone < Rig.NumBones; Bone++) {
+		if (!BoneTransforms.IsValidIndex(Rig.BoneIndices[Bone])) continue;
+
+		const FTransform& BoneTransform = BoneTransforms[Rig.BoneIndices[Bone]];
+		const FVector Offset = BoneTransform.GetLocation();
+		for (int32 Axis = 0; Axis < 3; Axis++) {
+			const int32 Quantized = FMath::RoundToInt(Offset[Axis] / HITBOX_OFFSET_PRECISION);
+			BoneOffsets[Bone][Axis] = static_cast<int16>(FMath::Clamp(Quantized, MIN_int16, MAX_int16));
+		}
+		BoneRotations[Bone] = CompressRotation(BoneTransform.GetRotation());
+	}
+}
+
+/**
+* Rebuilds each box as box-to-bone, then bone-to-mesh from the snapshot, then
+* mesh-to-world from the snapshot. Boxes without a bone go straight from
+* box-to-mesh to mesh-to-world. Every bone is unpacked once however many
+* boxes share it.
+*/
+void FPoseSnapshot::Materialize(const FHitBoxRig& Rig, FFramePackage& Package) const {
+	const FTransform MeshTransform(DecompressRotation(MeshRotation), FVector(MeshLocation), Rig.MeshScale);
+
+	FTransform BoneToWorld[HITBOX_NUM];
+	for (int32 Bone = 0; Bone < Rig.NumBones; Bone++) {
+		const FVector BoneLocation = FVector(BoneOffsets[Bone][0], BoneOffsets[Bone][1], BoneOffsets[Bone][2]) *
+			HITBOX_OFFSET_PRECISION;
+		BoneToWorld[Bone] = FTransform(DecompressRotation(BoneRotations[Bone]), BoneLocation) * MeshTransform;
+	}
+
+	for (int32 i = 0; i < HITBOX_NUM; i++) {
+		const FTransform BoxTransform = Rig.BoxBones[i] == INDEX_NONE ?
+			Rig.BoxToBone[i] * MeshTransform :
+			Rig.BoxToBone[i] * BoneToWorld[Rig.BoxBones[i]];
+		Package.Locations[i] = BoxTransform.GetLocation();
+		Package.Rotations[i] = BoxTransform.GetRotation();
+	}
+	FMemory::Memcpy(Package.BoxExtents, Rig.BoxExtents, sizeof(Package.BoxExtents));
+}
+
+/**
+* Smallest three encoding. The largest component is dropped and rebuilt from
+* the other three, since the quaternion is unit length. q and -q are the same
+* rotation, so the sign is flipped to make the dropped component positive.
+*
+* @return Index of the dropped component in the top 2 bits, then the other
+*		  three components at 10 bits each
+*/
+uint32 FPoseSnapshot::CompressRotation(const FQuat& Rotation) {
+	const FQuat Normalized = Rotation.GetNormalized();
+	const float Components[4] = { (float)Normalized.X, (float)Normalized.Y, (float)Normalized.Z, (float)Normalized.W };
+
+	int32 Largest = 0;
+	for (int32 i = 1; i < 4; i++) {
+		if (FMath::Abs(Components[i]) > FMath::Abs(Components[Largest])) {
+			Largest = i;
+		}
+	}
+	const float Sign = Components[Largest] < 0.f ? -1.f : 1.f;
+
+	uint32 Packed = static_cast<uint32>(Largest) << 30;
+	int32 Shift = 20;
+	for (int32 i = 0; i < 4; i++) {
+		if (i == Largest) continue;
+		Packed |= QuantizeQuatComponent(Components[i] * Sign) << Shift;
+		Shift -= 10;
+	}
+	return Packed;
+}
+
+FQuat FPoseSnapshot::DecompressRotation(uint32 Packed) {
+	const int32 Largest = Packed >> 30;
+
+	float Components[4];
+	float SumSquares = 0.f;
+	int32 Shift = 20;
+	for (int32 i = 0; i < 4; i++) {
+		if (i == Largest) continue;
+		Components[i] = DequantizeQuatComponent((Packed >> Shift) & QuatComponentMax);
+		SumSquares += Components[i] * Components[i];
+		Shift -= 10;
+	}
+	Components[Largest] = FMath::Sqrt(FMath::Max(1.f - SumSquares, 0.f));
+
+	return FQuat(Components[0], Components[1], Components[2], Components[3]).GetNormalized();
+}
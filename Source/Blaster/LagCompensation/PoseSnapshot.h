@@ -0,0 +1,81 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Blaster/BlasterTypes/HitBox.h"
+
+struct FFramePackage;
+class ABlasterCharacter;
+class USkeletalMeshComponent;
+
+// Size of one step of a quantized bone offset, in cm. With 16 bits this
+// covers bones up to 655 cm from the mesh origin.
+#define HITBOX_OFFSET_PRECISION 0.02f
+
+/**
+* How a character's hitboxes hang off its skeleton. None of this changes while
+* the character is alive, so it is read once when the character registers and
+* only the bones are saved every tick.
+*/
+struct FHitBoxRig {
+	// Mesh bone index of each bone a snapshot saves. Several boxes can share
+	// a bone, so there are at most HITBOX_NUM of them.
+	int32 BoneIndices[HITBOX_NUM];
+	int32 NumBones = 0;
+
+	// Which of BoneIndices each box is attached to, indexed by EHitBox.
+	// INDEX_NONE if the box is missing or not attached to a bone or socket.
+	int32 BoxBones[HITBOX_NUM];
+
+	// Each box relative to its bone, including any socket offset. Relative
+	// to the mesh for boxes without a bone.
+	FTransform BoxToBone[HITBOX_NUM];
+
+	FVector BoxExtents[HITBOX_NUM];
+
+	FVector MeshScale = FVector::OneVector;
+
+	// From the mesh origin to the actor root, in world space. Characters only
+	// ever yaw, so this stays the same however they turn.
+	FVector MeshToActor = FVector::ZeroVector;
+
+	// Radius around the actor root that contains every box, with room for
+	// the pose to change
+	float BoundsRadius = 0.f;
+
+	/** Reads the rig from the character's hitboxes and mesh */
+	void Build(const ABlasterCharacter* Character);
+};
+
+/**
+* One character's pose at one saved tick, packed for long histories. Only the
+* mesh transform and the bones the hitboxes attach to are stored. Bone
+* locations are 16 bit offsets in component space, rotations are smallest
+* three quaternions in 32 bits. World space boxes are only built when a
+* rewind actually reads the snapshot.
+*/
+struct FPoseSnapshot {
+	FVector3f MeshLocation;
+	uint32 MeshRotation;
+
+	int16 BoneOffsets[HITBOX_NUM][3];
+
+	uint32 BoneRotations[HITBOX_NUM];
+
+	/** Saves the mesh's current pose of every bone in Rig */
+	void Save(const FHitBoxRig& Rig, const USkeletalMeshComponent& Mesh);
+
+	/**
+	* Builds every box of the snapshot in world space into Package.
+	*
+	* @param Rig The rig the snapshot was saved with
+	* @param Package Frame to fill. Time and Character are left untouched.
+	*/
+	void Materialize(const FHitBoxRig& Rig, FFramePackage& Package) const;
+
+	FORCEINLINE FVector GetActorLocation(const FHitBoxRig& Rig) const { return FVector(MeshLocation) + Rig.MeshToActor; }
+
+	static uint32 CompressRotation(const FQuat& Rotation);
+	static FQuat DecompressRotation(uint32 Packed);
+};
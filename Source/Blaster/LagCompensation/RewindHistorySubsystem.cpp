@@ -0,0 +1,287 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "RewindHistorySubsystem.h"
+#include "Blaster/Character/BlasterCharacter.h"
+#include "Blaster/PlayerState/BlasterPlayerState.h"
+#include "Components/SkeletalMeshComponent.h"
+#include "HitBoxMath.h"
+
+bool URewindHistorySubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const {
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void FRewindHistoryTickFunction::ExecuteTick(float DeltaTime, ELevelTick TickType,
+	ENamedThreads::Type CurrentThread, const FGraphEventRef& MyCompletionGraphEvent) {
+	if (Target && TickType != LEVELTICK_ViewportsOnly) {
+		Target->TickHistory(DeltaTime);
+	}
+}
+
+FString FRewindHistoryTickFunction::DiagnosticMessage() {
+	return TEXT("FRewindHistoryTickFunction");
+}
+
+void URewindHistorySubsystem::OnWorldBeginPlay(UWorld& InWorld) {
+	Super::OnWorldBeginPlay(InWorld);
+
+	// History is only needed where hits are confirmed
+	if (InWorld.GetNetMode() == NM_Client) return;
+
+	HistoryTick.Target = this;
+	HistoryTick.bCanEverTick = true;
+	HistoryTick.bStartWithTickEnabled = true;
+	HistoryTick.TickGroup = TG_PostPhysics;
+	HistoryTick.RegisterTickFunction(InWorld.PersistentLevel);
+}
+
+void URewindHistorySubsystem::Deinitialize() {
+	if (HistoryTick.IsTickFunctionRegistered()) {
+		HistoryTick.UnRegisterTickFunction();
+	}
+	HistoryTick.Target = nullptr;
+	Super::Deinitialize();
+}
+
+/**
+* Saves a sample whenever at least one sample interval has passed since the
+* last. The leftover is carried over so the average rate is SampleRate, but it
+* is capped at one interval so a long frame doesn't cause a burst of samples.
+*/
+void URewindHistorySubsystem::TickHistory(float DeltaTime) {
+	if (NumRegistered == 0 || SampleRate <= 0.f) return;
+
+	const float SampleInterval = 1.f / SampleRate;
+	SampleAccumulator += DeltaTime;
+	if (SampleAccumulator < SampleInterval) return;
+
+	SampleAccumulator = FMath::Min(SampleAccumulator - SampleInterval, SampleInterval);
+	SaveTick();
+}
+
+double URewindHistorySubsystem::GetTimestamp() const {
+	const UWorld* World = GetWorld();
+	return World ? World->GetTimeSeconds() : 0.0;
+}
+
+/**
+* Gives a character a column in the history table. The table is allocated the
+* first time a character registers, which only happens on the server.
+*
+* @param Character The character to start saving every tick
+*/
+void URewindHistorySubsystem::RegisterCharacter(ABlasterCharacter* Character) {
+	if (Character == nullptr || Character->GetLagCompensation() == nullptr) return;
+	if (GetSlot(Character) != INDEX_NONE) return;
+
+	if (Ticks.Capacity() == 0) {
+		const int32 NumRows = FMath::CeilToInt(MaxRecordTime * SampleRate) + 1;
+		Ticks.Reset(NumRows);
+		PoseTable.SetNum(NumRows * MaxCharacters);
+		PoseOwners.SetNumZeroed(NumRows * MaxCharacters);
+		SlotCharacters.SetNumZeroed(MaxCharacters);
+		SlotSerials.SetNumZeroed(MaxCharacters);
+		SlotRigs.SetNum(MaxCharacters);
+	}
+
+	const int32 Slot = SlotCharacters.Find(nullptr);
+	if (Slot == INDEX_NONE) {
+		UE_LOG(LogTemp, Warning, TEXT("RewindHistorySubsystem: no free slot for %s, raise MaxCharacters"), *Character->GetName());
+		return;
+	}
+	SlotCharacters[Slot] = Character;
+	SlotSerials[Slot] = NextSerial++;
+	SlotRigs[Slot].Build(Character);
+	Character->GetLagCompensation()->RewindSlot = Slot;
+	++NumRegistered;
+}
+
+void URewindHistorySubsystem::UnregisterCharacter(ABlasterCharacter* Character) {
+	const int32 Slot = GetSlot(Character);
+	if (Slot == INDEX_NONE) return;
+
+	SlotCharacters[Slot] = nullptr;
+	SlotSerials[Slot] = 0;
+	Character->GetLagCompensation()->RewindSlot = INDEX_NONE;
+	--NumRegistered;
+}
+
+int32 URewindHistorySubsystem::GetSlot(const ABlasterCharacter* Character) const {
+	if (Character == nullptr || Character->GetLagCompensation() == nullptr) return INDEX_NONE;
+
+	const int32 Slot = Character->GetLagCompensation()->RewindSlot;
+	if (!SlotCharacters.IsValidIndex(Slot) || SlotCharacters[Slot] != Character) {
+		return INDEX_NONE;
+	}
+	return Slot;
+}
+
+/**
+* Saves one row of the history table with the pose of every registered
+* character, dropping rows that are older than RecordTime. Eliminated
+* characters keep their slot until they are destroyed, but their collision is
+* off, so their cells are saved as empty and shots rewound to then pass
+* through them like they do in game.
+*/
+void URewindHistorySubsystem::SaveTick() {
+	if (Ticks.Capacity() == 0) return;
+
+	UpdateRecordTime();
+	while (Ticks.Num() > 1 && Ticks.Newest().Time - Ticks.Oldest().Time > RecordTime) {
+		Ticks.RemoveOldest();
+	}
+	FRewindTick& ThisTick = Ticks.AddNewest();
+	ThisTick.Time = GetTimestamp();
+
+	const int32 RowStart = Ticks.GetStorageIndex(Ticks.Num() - 1) * MaxCharacters;
+	for (int32 Slot = 0; Slot < MaxCharacters; Slot++) {
+		ABlasterCharacter* Character = SlotCharacters[Slot];
+		if (Character == nullptr || Character->GetMesh() == nullptr || Character->IsEliminated()) {
+			PoseOwners[RowStart + Slot] = 0;
+			continue;
+		}
+		PoseTable[RowStart + Slot].Save(SlotRigs[Slot], *Character->GetMesh());
+		PoseOwners[RowStart + Slot] = SlotSerials[Slot];
+	}
+}
+
+/**
+* Keeps only as much history as the laggiest registered player could need, so
+* a server full of low ping players isn't holding on to a full MaxRecordTime.
+*/
+void URewindHistorySubsystem::UpdateRecordTime() {
+	float WorstWindow = 0.f;
+	for (const ABlasterCharacter* Character : SlotCharacters) {
+		const ABlasterPlayerState* PlayerState = Character ? Character->GetPlayerState<ABlasterPlayerState>() : nullptr;
+		if (PlayerState) {
+			WorstWindow = FMath::Max(WorstWindow, PlayerState->GetRoundTrip().GetRewindWindow());
+		}
+	}
+	RecordTime = FMath::Clamp(WorstWindow + RecordTimeMargin, MinRecordTime, MaxRecordTime);
+}
+
+/**
+* Binary searches the saved ticks for the two either side of Time.
+*
+* @param  Time The time to rewind to
+* @param  OutBracket The rows either side of Time. Both rows are the same if
+*		  Time is at or after the newest tick.
+* @return False if there is no history or Time is older than all of it
+*/
+bool URewindHistorySubsystem::FindBracket(double Time, FRewindBracket& OutBracket) const {
+	if (Ticks.IsEmpty() || Ticks.Oldest().Time > Time) {
+		// HitTime is beyond the maximum history range, could be too laggy
+		return false;
+	}
+	OutBracket.Time = Time;
+
+	if (Ticks.Newest().Time <= Time) {
+		const int32 Row = Ticks.GetStorageIndex(Ticks.Num() - 1);
+		OutBracket.OlderRow = Row;
+		OutBracket.YoungerRow = Row;
+		OutBracket.Alpha = 0.f;
+		return true;
+	}
+	// Oldest <= Time < Newest, so Younger is always in [1, Num() - 1]
+	const int32 YoungerIndex = Ticks.FindFirstYoungerThan(Time);
+	const FRewindTick& Older = Ticks[YoungerIndex - 1];
+	const FRewindTick& Younger = Ticks[YoungerIndex];
+
+	OutBracket.OlderRow = Ticks.GetStorageIndex(YoungerIndex - 1);
+	OutBracket.YoungerRow = Ticks.GetStorageIndex(YoungerIndex);
+	OutBracket.Alpha = static_cast<float>(FMath::Clamp((Time - Older.Time) / (Younger.Time - Older.Time), 0.0, 1.0));
+	return true;
+}
+
+double URewindHistorySubsystem::GetOldestTime() const {
+	return Ticks.IsEmpty() ? 0.0 : Ticks.Oldest().Time;
+}
+
+bool URewindHistorySubsystem::GetRootLocation(const ABlasterCharacter* Character,
+	const FRewindBracket& Bracket, FVector& OutLocation) const {
+	const int32 Slot = GetSlot(Character);
+	return Slot != INDEX_NONE && GetSlotRootLocation(Slot, Bracket, OutLocation);
+}
+
+/** Whether the character in Slot was saved in both ticks of the bracket */
+bool URewindHistorySubsystem::HasSlotFrame(int32 Slot, const FRewindBracket& Bracket) const {
+	if (Bracket.OlderRow == INDEX_NONE) return false;
+
+	// Character wasn't registered yet, or was eliminated, at this time
+	const int32 OlderCell = Bracket.OlderRow * MaxCharacters + Slot;
+	const int32 YoungerCell = Bracket.YoungerRow * MaxCharacters + Slot;
+	return PoseOwners[OlderCell] == SlotSerials[Slot] && PoseOwners[YoungerCell] == SlotSerials[Slot];
+}
+
+bool URewindHistorySubsystem::GetSlotRootLocation(int32 Slot, const FRewindBracket& Bracket,
+	FVector& OutLocation) const {
+	if (!HasSlotFrame(Slot, Bracket)) return false;
+
+	const int32 OlderCell = Bracket.OlderRow * MaxCharacters + Slot;
+	const int32 YoungerCell = Bracket.YoungerRow * MaxCharacters + Slot;
+	const FHitBoxRig& Rig = SlotRigs[Slot];
+	OutLocation = FMath::Lerp(PoseTable[OlderCell].GetActorLocation(Rig),
+		PoseTable[YoungerCell].GetActorLocation(Rig), Bracket.Alpha);
+	return true;
+}
+
+bool URewindHistorySubsystem::GetFrame(const ABlasterCharacter* Character,
+	const FRewindBracket& Bracket, FFramePackage& OutFrame) const {
+	const int32 Slot = GetSlot(Character);
+	return Slot != INDEX_NONE && GetSlotFrame(Slot, Bracket, OutFrame);
+}
+
+bool URewindHistorySubsystem::GetSlotFrame(int32 Slot, const FRewindBracket& Bracket,
+	FFramePackage& OutFrame) const {
+	if (!HasSlotFrame(Slot, Bracket)) return false;
+
+	const int32 OlderCell = Bracket.OlderRow * MaxCharacters + Slot;
+	const int32 YoungerCell = Bracket.YoungerRow * MaxCharacters + Slot;
+	const FHitBoxRig& Rig = SlotRigs[Slot];
+	if (OlderCell == YoungerCell || Bracket.Alpha <= 0.f) {
+		PoseTable[OlderCell].Materialize(Rig, OutFrame);
+	} else {
+		FFramePackage OlderFrame;
+		FFramePackage YoungerFrame;
+		PoseTable[OlderCell].Materialize(Rig, OlderFrame);
+		PoseTable[YoungerCell].Materialize(Rig, YoungerFrame);
+		InterpBetweenFrames(OlderFrame, YoungerFrame, Bracket.Alpha, OutFrame);
+	}
+	OutFrame.Time = Bracket.Time;
+	return true;
+}
+
+void URewindHistorySubsystem::GetCharactersInBracket(const FRewindBracket& Bracket,
+	TArray<AActor*>& OutCharacters) const {
+	for (int32 Slot = 0; Slot < SlotCharacters.Num(); Slot++) {
+		if (SlotCharacters[Slot] && HasSlotFrame(Slot, Bracket)) {
+			OutCharacters.Add(SlotCharacters[Slot]);
+		}
+	}
+}
+
+bool URewindHistorySubsystem::GetFrameAtTime(const ABlasterCharacter* Character, double Time,
+	FFramePackage& OutFrame) const {
+	FRewindBracket Bracket;
+	return FindBracket(Time, Bracket) && GetFrame(Character, Bracket, OutFrame);
+}
+
+/**
+* Interpolates every hitbox between two saved frames of the same character.
+*
+* @param  OlderFrame The frame on the older side of the rewind time
+* @param  YoungerFrame The frame on the younger side of the rewind time
+* @param  InterpFraction How far from OlderFrame to YoungerFrame, 0 to 1
+* @param  OutFrame Filled with hitboxes interpolated between older and younger.
+*		  Time is left untouched.
+*/
+void URewindHistorySubsystem::InterpBetweenFrames(const FFramePackage& OlderFrame,
+	const FFramePackage& YoungerFrame, float InterpFraction, FFramePackage& OutFrame) {
+	OutFrame.Character = YoungerFrame.Character;
+
+	HitBoxMath::InterpHitBoxes(OlderFrame.Locations, OlderFrame.Rotations,
+		YoungerFrame.Locations, YoungerFrame.Rotations,
+		HITBOX_NUM, InterpFraction, OutFrame.Locations, OutFrame.Rotations);
+
+	// Box extents never change between frames
+	FMemory::Memcpy(OutFrame.BoxExtents, YoungerFrame.BoxExtents, sizeof(OutFrame.BoxExtents));
+}
@@ -0,0 +1,238 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Blaster/BlasterTypes/FrameRingBuffer.h"
+#include "Blaster/BlasterComponents/LagCompensationComponent.h"
+#include "PoseSnapshot.h"
+#include "RewindHistorySubsystem.generated.h"
+
+class ABlasterCharacter;
+class URewindHistorySubsystem;
+
+/**
+* Saves the rewind history once per frame after physics, when every mesh has
+* finished its pose update and hitboxes are where clients will render them.
+*/
+USTRUCT()
+struct FRewindHistoryTickFunction : public FTickFunction {
+	GENERATED_BODY()
+
+	URewindHistorySubsystem* Target = nullptr;
+
+	virtual void ExecuteTick(float DeltaTime, ELevelTick TickType, ENamedThreads::Type CurrentThread,
+		const FGraphEventRef& MyCompletionGraphEvent) override;
+	virtual FString DiagnosticMessage() override;
+};
+
+template<>
+struct TStructOpsTypeTraits<FRewindHistoryTickFunction> : public TStructOpsTypeTraitsBase2<FRewindHistoryTickFunction> {
+	enum {
+		WithCopy = false
+	};
+};
+
+/**
+* The two saved ticks either side of a rewind time. Finding them once and then
+* reading every character from the same pair keeps multi-character rewinds,
+* like the shotgun, consistent with each other.
+*/
+struct FRewindBracket {
+	// Rows of the history table for the older and younger tick
+	int32 OlderRow = INDEX_NONE;
+	int32 YoungerRow = INDEX_NONE;
+
+	// How far from the older to the younger tick the rewind time is, 0 to 1
+	float Alpha = 0.f;
+
+	double Time = 0.0;
+};
+
+/**
+* Server-side history of every BlasterCharacter's hitboxes. At a fixed sample
+* rate every registered character's pose is saved into one contiguous table
+* with a row per sample and a column per character slot, so rewinds look up a
+* tick by time and then read each character by slot. Only the bones the
+* hitboxes attach to are saved, and boxes are built in world space just for
+* the two samples either side of a rewind.
+*/
+UCLASS(Config = Game)
+class BLASTER_API URewindHistorySubsystem : public UWorldSubsystem {
+	GENERATED_BODY()
+
+public:
+
+	virtual void OnWorldBeginPlay(UWorld& InWorld) override;
+	virtual void Deinitialize() override;
+
+	void TickHistory(float DeltaTime);
+
+	/**
+	* The clock every saved frame is stamped with. Clients sync GetServerTime to
+	* this, so rewind times sent by clients are on the same clock.
+	*/
+	double GetTimestamp() const;
+
+	/** Gives Character a slot so it is saved every tick. Server only. */
+	void RegisterCharacter(ABlasterCharacter* Character);
+	void UnregisterCharacter(ABlasterCharacter* Character);
+
+	bool FindBracket(double Time, FRewindBracket& OutBracket) const;
+
+	/** Time of the oldest saved tick, or 0 if there is no history yet */
+	double GetOldestTime() const;
+
+	/**
+	* Reads only where Character's actor root was at the bracket's time. Much
+	* cheaper than GetFrame since no boxes are unpacked.
+	*/
+	bool GetRootLocation(const ABlasterCharacter* Character, const FRewindBracket& Bracket,
+		FVector& OutLocation) const;
+
+	/**
+	* Reads Character's hitboxes at the bracket's time, interpolating between
+	* the two ticks. Fails if the character was not saved in both of them.
+	*/
+	bool GetFrame(const ABlasterCharacter* Character, const FRewindBracket& Bracket,
+		FFramePackage& OutFrame) const;
+
+	bool GetFrameAtTime(const ABlasterCharacter* Character, double Time,
+		FFramePackage& OutFrame) const;
+
+	/**
+	* Adds every character that was saved in both ticks of the bracket, without
+	* reading any of their frames.
+	*/
+	void GetCharactersInBracket(const FRewindBracket& Bracket, TArray<AActor*>& OutCharacters) const;
+
+	/**
+	* Reads every character that was saved in both ticks of the bracket.
+	* Character is set on each frame.
+	*/
+	template<typename AllocatorType>
+	void GetAllFrames(const FRewindBracket& Bracket, TArray<FFramePackage, AllocatorType>& OutFrames) const;
+
+	/**
+	* Reads every character with any of its boxes possibly within Radius of
+	* Origin at the bracket's time. Characters are culled by their saved root
+	* first, so only those close enough are unpacked. Character is set on each
+	* frame.
+	*/
+	template<typename AllocatorType>
+	void GetFramesInRadius(const FRewindBracket& Bracket, const FVector& Origin, float Radius,
+		TArray<FFramePackage, AllocatorType>& OutFrames) const;
+
+	static void InterpBetweenFrames(const FFramePackage& OlderFrame,
+		const FFramePackage& YoungerFrame, float InterpFraction, FFramePackage& OutFrame);
+
+protected:
+
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+private:
+
+	void SaveTick();
+	void UpdateRecordTime();
+	bool HasSlotFrame(int32 Slot, const FRewindBracket& Bracket) const;
+	bool GetSlotFrame(int32 Slot, const FRewindBracket& Bracket, FFramePackage& OutFrame) const;
+	bool GetSlotRootLocation(int32 Slot, const FRewindBracket& Bracket, FVector& OutLocation) const;
+
+	FRewindHistoryTickFunction HistoryTick;
+
+	// Time since the last sample, carried over between frames
+	float SampleAccumulator = 0.f;
+
+	struct FRewindTick {
+		double Time = 0.0;
+	};
+
+	// When each row of PoseTable was saved, oldest at index 0
+	TFrameRingBuffer<FRewindTick> Ticks;
+
+	// MaxCharacters snapshots per row, one row per entry in Ticks' storage
+	TArray<FPoseSnapshot> PoseTable;
+
+	// Built once per slot when the character registers
+	TArray<FHitBoxRig> SlotRigs;
+
+	// Registration serial of the character saved in each cell of PoseTable,
+	// 0 if the slot was empty or its character eliminated. Slots get reused, so this is what tells a
+	// character's own frames apart from the previous occupant's.
+	TArray<uint32> PoseOwners;
+
+	UPROPERTY()
+	TArray<ABlasterCharacter*> SlotCharacters;
+
+	TArray<uint32> SlotSerials;
+
+	uint32 NextSerial = 1;
+
+	int32 NumRegistered = 0;
+
+	// Most history ever kept, in seconds. The table is sized for this.
+	UPROPERTY(Config)
+	float MaxRecordTime = 1.f;
+
+	UPROPERTY(Config)
+	float MinRecordTime = 0.25f;
+
+	// History kept beyond the worst connection's rewind window, which leaves
+	// room for projectiles that flew for a while before they hit
+	UPROPERTY(Config)
+	float RecordTimeMargin = 0.5f;
+
+	// How much history is kept right now, between MinRecordTime and
+	// MaxRecordTime depending on the worst connection
+	float RecordTime = 1.f;
+
+	// Samples saved per second, independent of the server tick rate. At most one
+	// sample is saved per frame, so a server ticking slower saves fewer.
+	UPROPERTY(Config)
+	float SampleRate = 60.f;
+
+	UPROPERTY(Config)
+	int32 MaxCharacters = 32;
+
+	int32 GetSlot(const ABlasterCharacter* Character) const;
+
+public:
+
+	FORCEINLINE float GetMaxRecordTime() const { return MaxRecordTime; }
+	FORCEINLINE float GetRecordTime() const { return RecordTime; }
+};
+
+template<typename AllocatorType>
+void URewindHistorySubsystem::GetAllFrames(const FRewindBracket& Bracket,
+	TArray<FFramePackage, AllocatorType>& OutFrames) const {
+	for (int32 Slot = 0; Slot < SlotCharacters.Num(); Slot++) {
+		if (SlotCharacters[Slot] == nullptr) continue;
+
+		FFramePackage Frame;
+		if (GetSlotFrame(Slot, Bracket, Frame)) {
+			Frame.Character = SlotCharacters[Slot];
+			OutFrames.Add(Frame);
+		}
+	}
+}
+
+template<typename AllocatorType>
+void URewindHistorySubsystem::GetFramesInRadius(const FRewindBracket& Bracket, const FVector& Origin,
+	float Radius, TArray<FFramePackage, AllocatorType>& OutFrames) const {
+	for (int32 Slot = 0; Slot < SlotCharacters.Num(); Slot++) {
+		if (SlotCharacters[Slot] == nullptr) continue;
+
+		FVector RootLocation;
+		if (!GetSlotRootLocation(Slot, Bracket, RootLocation) ||
+			FVector::DistSquared(RootLocation, Origin) > FMath::Square(Radius + SlotRigs[Slot].BoundsRadius)) {
+			continue;
+		}
+		FFramePackage& Frame = OutFrames.AddDefaulted_GetRef();
+		if (GetSlotFrame(Slot, Bracket, Frame)) {
+			Frame.Character = SlotCharacters[Slot];
+		} else {
+			OutFrames.Pop(false);
+		}
+	}
+}
@@ -0,0 +1,29 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "RoundTripEstimator.h"
+
+namespace {
+	// Gains from RFC 6298
+	constexpr float RttGain = 1.f / 8.f;
+	constexpr float VariationGain = 1.f / 4.f;
+	constexpr float VariationScale = 4.f;
+
+	// Samples are clamped to this so a stall doesn't wreck the estimate
+	constexpr float MaxRttSample = 2.f;
+}
+
+void FRoundTripEstimator::AddSample(float Rtt) {
+	Rtt = FMath::Clamp(Rtt, 0.f, MaxRttSample);
+	if (NumSamples == 0) {
+		SmoothedRtt = Rtt;
+		RttVariation = 0.5f * Rtt;
+	} else {
+		RttVariation += VariationGain * (FMath::Abs(SmoothedRtt - Rtt) - RttVariation);
+		SmoothedRtt += RttGain * (Rtt - SmoothedRtt);
+	}
+	++NumSamples;
+}
+
+float FRoundTripEstimator::GetRewindWindow() const {
+	return SmoothedRtt + VariationScale * RttVariation;
+}
@@ -0,0 +1,39 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+* Smoothed round trip time and its variation for one connection, kept the same
+* way TCP keeps its retransmission timer. A single slow sample only nudges the
+* estimate, while steady jitter widens the window.
+*/
+struct FRoundTripEstimator {
+	// Seconds
+	float SmoothedRtt = 0.f;
+	float RttVariation = 0.f;
+
+	int32 NumSamples = 0;
+
+	void AddSample(float Rtt);
+
+	/**
+	* How far back, in seconds, a shot from this connection can reasonably
+	* need to rewind. Covers the smoothed round trip plus a few times its
+	* variation.
+	*/
+	float GetRewindWindow() const;
+
+	/**
+	* Rough bound on how far this connection's synced server clock could be
+	* off, in seconds. The server's view of FClockSync::GetUncertainty, which
+	* only the client can compute exactly.
+	*/
+	FORCEINLINE float GetClockErrorBound() const { return 0.5f * SmoothedRtt + RttVariation; }
+
+	/** Roughly how far behind the server this connection sees the world */
+	FORCEINLINE float GetOneWayTime() const { return 0.5f * SmoothedRtt; }
+
+	FORCEINLINE bool HasSamples() const { return NumSamples > 0; }
+};
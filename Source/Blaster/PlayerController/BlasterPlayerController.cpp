@@ -19,6 +19,7 @@
 #include "Blaster/HUD/ReturnToMainMenu.h"
 #include "EnhancedInputComponent.h"
 #include "Blaster/BlasterTypes/Announcement.h"
+#include "Blaster/Weapon/Weapon.h"
 
 
 
@@ -65,9 +66,6 @@ void ABlasterPlayerController::CheckPing(float DeltaTime) {
 			if (PlayerState->GetCompressedPing() > HighPingThreshold) {
 				HighPingWarning();
 				PingAnimationRunningTime = 0.f;
-				ServerReportPingStatus(true);
-			} else {
-				ServerReportPingStatus(false);
 			}
 		}
 		HighPingRunningTime = 0.f;
@@ -96,11 +94,6 @@ void ABlasterPlayerController::OnRep_ShowTeamScores() {
 
 
 
-// Is the ping too high?
-void ABlasterPlayerController::ServerReportPingStatus_Implementation(bool bHighPing) {
-	HighPingDelegate.Broadcast(bHighPing);
-}
-
 void ABlasterPlayerController::PollInit() {
 	if (CharacterOverlay == nullptr) {
 		if (BlasterHUD && BlasterHUD->CharacterOverlay) {
@@ -178,10 +171,11 @@ void ABlasterPlayerController::ClientJoinMidGame_Implementation(FName StateOfMat
 	}
 }
 
-// Every five seconds do a sync
+// Sync quickly until the window is full, then every TimeSyncFrequency seconds
 void ABlasterPlayerController::CheckTimeSync(float DeltaTime) {
 	TimeSyncRunningTime += DeltaTime;
-	if (IsLocalController() && TimeSyncRunningTime > TimeSyncFrequency) {
+	const float Frequency = ClockSync.IsWindowFull() ? TimeSyncFrequency : TimeSyncWarmupFrequency;
+	if (IsLocalController() && TimeSyncRunningTime > Frequency) {
 		ServerRequestServerTime(GetWorld()->GetTimeSeconds());
 		TimeSyncRunningTime = 0.f;
 	}
@@ -414,16 +408,17 @@ void ABlasterPlayerController::SetHUDTime() {
 		}
 	}
 
+	const float ServerTime = static_cast<float>(GetServerTime());
 	float TimeLeft = 0.f;
 	if (MatchState == MatchState::WaitingToStart) {
-		TimeLeft = WarmupTime - GetServerTime() + LevelStartingTime;
+		TimeLeft = WarmupTime - ServerTime + LevelStartingTime;
 	} else if (MatchState == MatchState::InProgress) {
-		TimeLeft = WarmupTime + MatchTime - GetServerTime() + LevelStartingTime;
+		TimeLeft = WarmupTime + MatchTime - ServerTime + LevelStartingTime;
 	} else if (MatchState == MatchState::Cooldown) {
-		TimeLeft = CooldownTime + WarmupTime + MatchTime - GetServerTime() + LevelStartingTime;
+		TimeLeft = CooldownTime + WarmupTime + MatchTime - ServerTime + LevelStartingTime;
 	}
 
-	uint32 SecondsLeft = FMath::CeilToInt(MatchTime - GetServerTime());
+	uint32 SecondsLeft = FMath::CeilToInt(MatchTime - ServerTime);
 	if (HasAuthority()) { // If we are the server, get the game mode
 		BlasterGameMode = BlasterGameMode == nullptr ? Cast<ABlasterGameMode>(UGameplayStatics::GetGameMode(this)) : BlasterGameMode;
 		if (BlasterGameMode) {
@@ -441,21 +436,36 @@ void ABlasterPlayerController::SetHUDTime() {
 	CountdownInt = SecondsLeft;
 }
 
-void ABlasterPlayerController::ServerRequestServerTime_Implementation(float TimeOfClientRequest) {
-	float ServerTimeOfReceipt = GetWorld()->GetTimeSeconds();
+/**
+* Time sync runs on doubles end to end. These RPCs are rare, so the full width
+* of the clock goes over the wire rather than a quantized time.
+*/
+void ABlasterPlayerController::ServerRequestServerTime_Implementation(double TimeOfClientRequest) {
+	double ServerTimeOfReceipt = GetWorld()->GetTimeSeconds();
 	ClientReportServerTime(TimeOfClientRequest, ServerTimeOfReceipt);
 }
 
-void ABlasterPlayerController::ClientReportServerTime_Implementation(float TimeOfClientRequest, float TimeServerReceivedClientRequest) {
-	float RoundTripTime = GetWorld()->GetTimeSeconds() - TimeOfClientRequest;
-	SingleTripTime = 0.5f * RoundTripTime;
-	float CurrentServerTime = TimeServerReceivedClientRequest + SingleTripTime;
-	ClientServerDelta = CurrentServerTime - GetWorld()->GetTimeSeconds();
+void ABlasterPlayerController::ClientReportServerTime_Implementation(double TimeOfClientRequest, double TimeServerReceivedClientRequest) {
+	ClockSync.AddSample(TimeOfClientRequest, TimeServerReceivedClientRequest, GetWorld()->GetTimeSeconds());
+	SingleTripTime = ClockSync.GetSingleTripTime();
 }
 
+double ABlasterPlayerController::GetServerTime() {
+	return ClockSync.GetServerTime(GetWorld()->GetTimeSeconds());
+}
 
-float ABlasterPlayerController::GetServerTime() {
-	return GetWorld()->GetTimeSeconds() + ClientServerDelta;
+void ABlasterPlayerController::ClientShotEvents_Implementation(const TArray<FShotEvent>& Shots,
+	const TArray<ABlasterCharacter*>& DistantShooters) {
+	for (const FShotEvent& Shot : Shots) {
+		if (Shot.Shooter && Shot.Shooter->GetCombat()) {
+			Shot.Shooter->GetCombat()->PlayShotEvent(Shot.Input);
+		}
+	}
+	for (ABlasterCharacter* Shooter : DistantShooters) {
+		if (Shooter && Shooter->GetEquippedWeapon()) {
+			Shooter->GetEquippedWeapon()->PlayDistantFireSound();
+		}
+	}
 }
 
 void ABlasterPlayerController::ReceivedPlayer() {
@@ -5,10 +5,10 @@
 #include "CoreMinimal.h"
 #include "GameFramework/PlayerController.h"
 #include "Blaster/Weapon/WeaponTypes.h"
+#include "Blaster/LagCompensation/ClockSync.h"
+#include "Blaster/BlasterTypes/ShotEvent.h"
 #include "BlasterPlayerController.generated.h"
 
-DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FHighPingDelegate, bool, bPingTooHigh);
-
 /**
  *
  */
@@ -37,17 +37,27 @@ public:
 	void SetHUDBlueTeamScore(int32 BlueScore);
 	void HideTeamScores();
 	void InitTeamScores();
-	virtual float GetServerTime(); //  Sync with server world clock
+	virtual double GetServerTime(); //  Sync with server world clock
 	virtual void ReceivedPlayer() override; // Sync with server clock as soon as possible
 	void OnMatchStateSet(FName State, bool bTeamsMatch = false);
 	void HandleMatchHasStarted(bool bTeamsMatch = false);
 	void HandleCooldown();
 
-	float SingleTripTime = 0.f;
+	double SingleTripTime = 0.0;
 
-	FHighPingDelegate HighPingDelegate;
+	FORCEINLINE const FClockSync& GetClockSync() const { return ClockSync; }
 
 	void BroadcastEliminated(APlayerState* Attacker, APlayerState* Victim);
+
+	/**
+	* Shots fired around this player during one server frame, see
+	* UShotEventSubsystem. Shot effects are cosmetic, so lost ones aren't resent.
+	*
+	* @param  Shots Shots to play in full
+	* @param  DistantShooters Characters whose shots are only heard, one entry per shot
+	*/
+	UFUNCTION(Client, Unreliable)
+	void ClientShotEvents(const TArray<FShotEvent>& Shots, const TArray<class ABlasterCharacter*>& DistantShooters);
 protected:
 
 	virtual void BeginPlay() override;
@@ -61,19 +71,25 @@ protected:
 
 	// Requests the current server time, passing in the client's time when the request was sent
 	UFUNCTION(Server, Reliable)
-	void ServerRequestServerTime(float TimeOfClientRequest);
+	void ServerRequestServerTime(double TimeOfClientRequest);
 
 	// Reports the current server time to the client in response to ServerRequestServerTime
 	UFUNCTION(Client, Reliable)
-	void ClientReportServerTime(float TimeOfClientRequest, float TimeServerReceivedClientRequest);
+	void ClientReportServerTime(double TimeOfClientRequest, double TimeServerReceivedClientRequest);
 
 	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Input, meta = (AllowPrivateAccess = "true"))
 	class UInputAction* EscapeMenuAction;
 
-	float ClientServerDelta = 0.f; //  Difference between client and server time
+	// Filtered estimate of the server clock from every sync round trip
+	FClockSync ClockSync;
 
 	UPROPERTY(EditAnywhere, Category = Time)
-	float TimeSyncFrequency = 5.f;
+	float TimeSyncFrequency = 2.f;
+
+	// Sync interval until the clock sync window has filled up, so a fresh
+	// connection gets a trustworthy clock within a few seconds
+	UPROPERTY(EditAnywhere, Category = Time)
+	float TimeSyncWarmupFrequency = 0.2f;
 
 	float TimeSyncRunningTime = 0.f;
 
@@ -170,9 +186,6 @@ private:
 	UPROPERTY(EditAnywhere)
 	float CheckPingFrequency = 20.f;
 
-	UFUNCTION(Server, Reliable)
-	void ServerReportPingStatus(bool bHighPing);
-
 	UPROPERTY(EditAnywhere)
 	float HighPingThreshold = 50.f;
 };
@@ -14,6 +14,12 @@ void ABlasterPlayerState::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>&
 	DOREPLIFETIME(ABlasterPlayerState, Team);
 }
 
+void ABlasterPlayerState::UpdatePing(float InPing) {
+	Super::UpdatePing(InPing);
+
+	RoundTrip.AddSample(InPing);
+}
+
 void ABlasterPlayerState::AddToScore(float ScoreAmount) {
 	SetScore(GetScore() + ScoreAmount);
 	Character = Character == nullptr ? Cast<ABlasterCharacter>(GetPawn()) : Character;
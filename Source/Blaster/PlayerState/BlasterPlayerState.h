@@ -5,6 +5,7 @@
 #include "CoreMinimal.h"
 #include "GameFramework/PlayerState.h"
 #include "Blaster/BlasterTypes/Team.h"
+#include "Blaster/LagCompensation/RoundTripEstimator.h"
 #include "BlasterPlayerState.generated.h"
 
 /**
@@ -22,6 +23,9 @@ public:
 	*/
 	virtual void OnRep_Score() override;
 
+	// Feeds every ping the net driver measures into RoundTrip
+	virtual void UpdatePing(float InPing) override;
+
 	UFUNCTION()
 	virtual void OnRep_Defeats();
 
@@ -47,7 +51,12 @@ private:
 	UFUNCTION()
 	void OnRep_Team();
 
+	// On the server, how this player's connection has been behaving. Sizes how
+	// far back their shots are allowed to rewind.
+	FRoundTripEstimator RoundTrip;
+
 public:
 	FORCEINLINE ETeam GetTeam() const { return Team; }
 	void SetTeam(ETeam TeamToSet);
+	FORCEINLINE const FRoundTripEstimator& GetRoundTrip() const { return RoundTrip; }
 };
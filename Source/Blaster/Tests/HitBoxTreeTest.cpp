@@ -0,0 +1,83 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "Misc/AutomationTest.h"
+#include "Blaster/BlasterComponents/LagCompensationComponent.h"
+#include "Blaster/Character/BlasterCharacter.h"
+#include "Blaster/LagCompensation/HitBoxTree.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace {
+	// Every box starts out tiny and far below the shots, so only the boxes a
+	// case places can be hit
+	FFramePackage MakeFrame(ABlasterCharacter* Character) {
+		FFramePackage Frame;
+		Frame.Character = Character;
+		for (int32 i = 0; i < HITBOX_NUM; i++) {
+			Frame.Locations[i] = FVector(0.f, 0.f, -10000.f);
+			Frame.Rotations[i] = FQuat::Identity;
+			Frame.BoxExtents[i] = FVector(1.f);
+		}
+		return Frame;
+	}
+
+	void PlaceBox(FFramePackage& Frame, EHitBox HitBox, const FVector& Location, const FVector& Extent) {
+		Frame.Locations[static_cast<int32>(HitBox)] = Location;
+		Frame.BoxExtents[static_cast<int32>(HitBox)] = Extent;
+	}
+}
+
+/**
+* Resolving a hitscan shot through the hitbox tree has to score the same as
+* confirming it against the character the tree picks, head priority included.
+* The character is only used as an identity here, so its class default
+* stands in. Without a world nothing in the level occludes the shot.
+*/
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FHitBoxTreeConfirmHitTest, "Blaster.LagCompensation.HitBoxTreeMatchesConfirmHit",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FHitBoxTreeConfirmHitTest::RunTest(const FString& Parameters) {
+	ULagCompensationComponent* LagCompensation = NewObject<ULagCompensationComponent>();
+	ABlasterCharacter* Target = GetMutableDefault<ABlasterCharacter>();
+
+	const FVector_NetQuantize TraceStart(0.f, 0.f, 0.f);
+	const FVector_NetQuantize HitLocation(1000.f, 0.f, 0.f);
+
+	struct FCase {
+		const TCHAR* Name;
+		FVector HeadLocation;
+		bool bExpectHeadShot;
+	};
+	const FCase Cases[] = {
+		// Clips the torso first, then goes on through the head
+		{ TEXT("Torso then head"), FVector(540.f, 0.f, 0.f), true },
+		// Head is off the line, only the torso is crossed
+		{ TEXT("Torso only"), FVector(540.f, 0.f, 100.f), false },
+	};
+
+	for (const FCase& Case : Cases) {
+		FFramePackage Frame = MakeFrame(Target);
+		PlaceBox(Frame, EHitBox::EHB_Spine03, FVector(500.f, 0.f, 0.f), FVector(20.f));
+		PlaceBox(Frame, EHitBox::EHB_Head, Case.HeadLocation, FVector(15.f));
+
+		FHitBoxTree Tree;
+		Tree.Build(MakeArrayView(&Frame, 1));
+
+		const FServerSideRewindResult Confirmed = LagCompensation->ConfirmHit(Frame, Target, TraceStart, HitLocation);
+		ABlasterCharacter* TreeCharacter = nullptr;
+		const FServerSideRewindResult Resolved =
+			LagCompensation->ServerSideRewindAll(Tree, TraceStart, HitLocation, TreeCharacter);
+
+		TestTrue(FString::Printf(TEXT("%s: ConfirmHit hits"), Case.Name), Confirmed.bHitConfirmed);
+		TestEqual(FString::Printf(TEXT("%s: ConfirmHit headshot"), Case.Name), Confirmed.bHeadShot, Case.bExpectHeadShot);
+		TestEqual(FString::Printf(TEXT("%s: tree agrees on the hit"), Case.Name),
+			Resolved.bHitConfirmed, Confirmed.bHitConfirmed);
+		TestEqual(FString::Printf(TEXT("%s: tree agrees on the headshot"), Case.Name),
+			Resolved.bHeadShot, Confirmed.bHeadShot);
+		TestTrue(FString::Printf(TEXT("%s: tree picks the character"), Case.Name), TreeCharacter == Target);
+	}
+
+	return true;
+}
+
+#endif // WITH_DEV_AUTOMATION_TESTS
@@ -0,0 +1,118 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "Misc/AutomationTest.h"
+#include "Engine/Engine.h"
+#include "Engine/World.h"
+#include "Blaster/BlasterComponents/LagCompensationComponent.h"
+#include "Blaster/Character/BlasterCharacter.h"
+#include "Blaster/LagCompensation/HitValidationSubsystem.h"
+#include "Blaster/LagCompensation/RewindHistorySubsystem.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace {
+	const FVector ShooterLocation(0.f, 0.f, 100.f);
+	const FVector TargetLocation(300.f, 0.f, 100.f);
+
+	enum class EShotKind {
+		HitScan,
+		Projectile,
+		Shotgun
+	};
+
+	void QueueShot(UHitValidationSubsystem& HitValidation, ABlasterCharacter& Shooter,
+		ABlasterCharacter& Target, EShotKind Kind) {
+		const double Time = HitValidation.GetWorld()->GetTimeSeconds();
+		if (Kind == EShotKind::Shotgun) {
+			TArray<ABlasterCharacter*> HitCharacters;
+			HitCharacters.Add(&Target);
+			TArray<FVector_NetQuantize> HitLocations;
+			for (int32 i = 0; i < SHOTGUN_MAX_PELLETS; i++) {
+				HitLocations.Add(FVector(1000.f, (i % 8 - 4) * 2.f, 100.f + (i / 8 - 2) * 2.f));
+			}
+			HitValidation.QueueShotgun(Shooter.GetLagCompensation(), HitCharacters, ShooterLocation, HitLocations, Time);
+			return;
+		}
+
+		FShotReport Report;
+		Report.HitCharacter = &Target;
+		Report.bProjectile = Kind == EShotKind::Projectile;
+		if (Report.bProjectile) {
+			// The world never ticks, so the projectile is fired right next to
+			// the target to reach it within one step
+			Report.TraceStart = TargetLocation - FVector(100.f, 0.f, 0.f);
+			Report.ShotVector = FVector(15000.f, 0.f, 0.f);
+		} else {
+			Report.TraceStart = ShooterLocation;
+			Report.ShotVector = FVector(1000.f, 0.f, 100.f);
+		}
+		HitValidation.QueueShotReport(Shooter.GetLagCompensation(), Report, Time);
+	}
+}
+
+/**
+* Once a pass has grown the storage validation reuses, validating another hit
+* of the same kind shouldn't touch the heap. The characters have no mesh, so
+* their hitboxes are rewound as if fixed to the mesh origin.
+*/
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FHitValidationAllocationTest, "Blaster.LagCompensation.HitValidationDoesNotAllocate",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FHitValidationAllocationTest::RunTest(const FString& Parameters) {
+	UWorld* World = UWorld::CreateWorld(EWorldType::Game, false);
+	FWorldContext& WorldContext = GEngine->CreateNewWorldContext(EWorldType::Game);
+	WorldContext.SetCurrentWorld(World);
+	World->InitializeActorsForPlay(FURL());
+
+	// Registering with the rewind history happens in the lag compensation
+	// component's BeginPlay
+	ABlasterCharacter* Shooter = World->SpawnActor<ABlasterCharacter>(ShooterLocation, FRotator::ZeroRotator);
+	ABlasterCharacter* Target = World->SpawnActor<ABlasterCharacter>(TargetLocation, FRotator::ZeroRotator);
+	UHitValidationSubsystem* HitValidation = World->GetSubsystem<UHitValidationSubsystem>();
+	URewindHistorySubsystem* RewindHistory = World->GetSubsystem<URewindHistorySubsystem>();
+	if (!TestNotNull(TEXT("Shooter"), Shooter) || !TestNotNull(TEXT("Target"), Target) ||
+		!TestNotNull(TEXT("Hit validation"), HitValidation) || !TestNotNull(TEXT("Rewind history"), RewindHistory)) {
+		GEngine->DestroyWorldContext(World);
+		World->DestroyWorld(false);
+		return false;
+	}
+	Shooter->DispatchBeginPlay();
+	Target->DispatchBeginPlay();
+
+	// Two saved ticks, both at the world's current time
+	RewindHistory->TickHistory(1.f);
+	RewindHistory->TickHistory(1.f);
+
+	struct FCase {
+		const TCHAR* Name;
+		EShotKind Kind;
+	};
+	const FCase Cases[] = {
+		{ TEXT("Hitscan"), EShotKind::HitScan },
+		{ TEXT("Projectile"), EShotKind::Projectile },
+		{ TEXT("Shotgun"), EShotKind::Shotgun },
+	};
+
+	const FHitValidationStats& Stats = HitValidation->GetStats();
+	for (const FCase& Case : Cases) {
+		// The first pass is allowed to grow reused storage
+		QueueShot(*HitValidation, *Shooter, *Target, Case.Kind);
+		HitValidation->FlushRequests();
+
+		const int32 RewoundBefore = Stats.Rewound.GetValue();
+		const int32 AllocationsBefore = Stats.Allocations.GetValue();
+		QueueShot(*HitValidation, *Shooter, *Target, Case.Kind);
+		HitValidation->FlushRequests();
+
+		TestEqual(FString::Printf(TEXT("%s: request was rewound"), Case.Name),
+			Stats.Rewound.GetValue() - RewoundBefore, 1);
+		TestEqual(FString::Printf(TEXT("%s: allocations"), Case.Name),
+			Stats.Allocations.GetValue() - AllocationsBefore, 0);
+	}
+
+	GEngine->DestroyWorldContext(World);
+	World->DestroyWorld(false);
+	return true;
+}
+
+#endif // WITH_DEV_AUTOMATION_TESTS
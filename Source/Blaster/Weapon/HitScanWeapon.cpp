@@ -12,8 +12,8 @@
 #include "Blaster/BlasterComponents/LagCompensationComponent.h"
 #include "Blaster/PlayerController/BlasterPlayerController.h"
 
-void AHitScanWeapon::Fire(const FVector& HitTarget) {
-	Super::Fire(HitTarget);
+void AHitScanWeapon::Fire(const FVector& HitTarget, uint16 ShotSequence) {
+	Super::Fire(HitTarget, ShotSequence);
 
 	APawn* OwnerPawn = Cast<APawn>(GetOwner());
 	if (OwnerPawn == nullptr) return;
@@ -45,11 +45,11 @@ void AHitScanWeapon::Fire(const FVector& HitTarget) {
 					Cast<ABlasterCharacter>(OwnerPawn) : BlasterOwnerCharacter;
 
 				BlasterOwnerController = BlasterOwnerController == nullptr ?
-					Cast<ABlasterPlayerController>(OwnerPawn) : BlasterOwnerController;
+					Cast<ABlasterPlayerController>(InstigatorController) : BlasterOwnerController;
 
 				if (BlasterOwnerController && BlasterOwnerCharacter && BlasterOwnerCharacter->GetLagCompensation() && BlasterOwnerCharacter->IsLocallyControlled()) {
-					BlasterOwnerCharacter->GetLagCompensation()->ServerScoreRequest(
-						BlasterCharacter, Start, HitTarget,
+					BlasterOwnerCharacter->GetLagCompensation()->QueueScoreRequest(
+						BlasterCharacter, Start, HitTarget, ShotSequence,
 						BlasterOwnerController->GetServerTime() - BlasterOwnerController->SingleTripTime);
 				}
 			}
@@ -14,7 +14,7 @@ class BLASTER_API AHitScanWeapon : public AWeapon {
 	GENERATED_BODY()
 
 public:
-	virtual void Fire(const FVector& HitTarget) override;
+	virtual void Fire(const FVector& HitTarget, uint16 ShotSequence) override;
 	
 
 protected:
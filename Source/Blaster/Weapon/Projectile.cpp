@@ -8,6 +8,7 @@
 #include "Sound/SoundCue.h"
 #include "Blaster/Character/BlasterCharacter.h"
 #include "Blaster/Blaster.h"
+#include "Blaster/BlasterComponents/LagCompensationComponent.h"
 #include "NiagaraSystemInstanceController.h"
 #include "NiagaraFunctionLibrary.h"
 
@@ -76,21 +77,43 @@ void AProjectile::DestroyTimerFinished() {
 	Destroy();
 }
 
+/**
+* Explosions from a BlasterCharacter damage characters where they were on its
+* client when the explosion happened, from the server's rewind history. Every
+* other actor has no history and takes damage from where it is right now, as
+* does everything when there is no history.
+*/
 void AProjectile::ExplodeDamage() {
 	APawn* FiringPawn = GetInstigator();
 	if (FiringPawn && HasAuthority()) {
 		AController* FiringController = FiringPawn->GetController();
 		if (FiringController) {
+			const FRadialDamageParams Params(Damage, 10.f, DamageInnerRadius, DamageOuterRadius, 1.f);
+
+			ABlasterCharacter* FiringCharacter = Cast<ABlasterCharacter>(FiringPawn);
+			ULagCompensationComponent* LagCompensation =
+				FiringCharacter ? FiringCharacter->GetLagCompensation() : nullptr;
+			TArray<FExplosionHit, TInlineAllocator<EXPLOSION_MAX_TARGETS>> Hits;
+			// Characters the rewind judged have already taken their rewound
+			// damage, or were out of reach then. Anyone else is damaged live.
+			TArray<AActor*> IgnoreActors;
+			if (LagCompensation && LagCompensation->ExplosionServerSideRewind(GetActorLocation(), Params, Hits, IgnoreActors)) {
+				for (const FExplosionHit& Hit : Hits) {
+					UGameplayStatics::ApplyDamage(Hit.Character, Hit.Damage,
+						FiringController, this, UDamageType::StaticClass());
+				}
+			}
+
 			UGameplayStatics::ApplyRadialDamageWithFalloff(
 				this,						// World context object
 				Damage,						// Base damage
-				10.f,						// Minimum damage
+				Params.MinimumDamage,		// Minimum damage
 				GetActorLocation(),			// Origin
 				DamageInnerRadius,						// Damage inner radius
 				DamageOuterRadius,						// Damage outer radius
 				1.f,						// Damage falloff
 				UDamageType::StaticClass(), // Damage type class
-				TArray<AActor*>(),			// Ignore actors
+				IgnoreActors,				// Ignore actors
 				this,						// Damage Causer
 				FiringController);			// Instigator controller
 		}
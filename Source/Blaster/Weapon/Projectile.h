@@ -24,6 +24,12 @@ public:
 	FVector_NetQuantize TraceStart;
 	FVector_NetQuantize100 InitialVelocity;
 
+	// Server time at which the owning client fired this projectile
+	double FireTime = 0.0;
+
+	// Sequence number of the shot that fired this projectile
+	uint16 ShotSequence = 0;
+
 	UPROPERTY(EditAnywhere)
 	float InitialSpeed = 15000.f;
 
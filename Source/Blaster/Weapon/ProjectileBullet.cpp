@@ -87,9 +87,8 @@ void AProjectileBullet::OnHit(UPrimitiveComponent* HitComp,
 			if (bUseServerSideRewind && OwnerCharacter->GetLagCompensation() && 
 				OwnerCharacter->IsLocallyControlled() && OtherCharacter) {
 
-				OwnerCharacter->GetLagCompensation()->ProjectileServerScoreRequest(
-				OtherCharacter, TraceStart, InitialVelocity, 
-				OwnerController->GetServerTime() - OwnerController->SingleTripTime);
+				OwnerCharacter->GetLagCompensation()->QueueProjectileScoreRequest(
+				OtherCharacter, TraceStart, InitialVelocity, ShotSequence, FireTime);
 
 
 			}
@@ -3,9 +3,10 @@
 #include "ProjectileWeapon.h"
 #include "Engine/SkeletalMeshSocket.h"
 #include "Projectile.h"
+#include "Blaster/PlayerController/BlasterPlayerController.h"
 
-void AProjectileWeapon::Fire(const FVector& HitTarget) {
-	Super::Fire(HitTarget);
+void AProjectileWeapon::Fire(const FVector& HitTarget, uint16 ShotSequence) {
+	Super::Fire(HitTarget, ShotSequence);
 
 	
 	APawn* InstigatorPawn = Cast<APawn>(GetOwner());
@@ -46,6 +47,14 @@ void AProjectileWeapon::Fire(const FVector& HitTarget) {
 					SpawnedProjectile->bUseServerSideRewind = true;
 					SpawnedProjectile->TraceStart = SocketTransform.GetLocation();
 					SpawnedProjectile->InitialVelocity = SpawnedProjectile->GetActorForwardVector() * SpawnedProjectile->InitialSpeed;
+					SpawnedProjectile->ShotSequence = ShotSequence;
+
+					BlasterOwnerController = BlasterOwnerController == nullptr ?
+						Cast<ABlasterPlayerController>(InstigatorPawn->Controller) : BlasterOwnerController;
+					if (BlasterOwnerController) {
+						SpawnedProjectile->FireTime =
+							BlasterOwnerController->GetServerTime() - BlasterOwnerController->SingleTripTime;
+					}
 
 				} else { // Simulatedproxy. Spawn non-replicated projectile, no SSR
 					SpawnedProjectile = World->SpawnActor<AProjectile>(ServerSideRewindProjectileClass, SocketTransform.GetLocation(),
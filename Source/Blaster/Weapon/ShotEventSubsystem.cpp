@@ -0,0 +1,111 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "ShotEventSubsystem.h"
+#include "Blaster/Character/BlasterCharacter.h"
+#include "Blaster/PlayerController/BlasterPlayerController.h"
+
+namespace {
+	struct FShooterPerception {
+		const ABlasterCharacter* Shooter;
+		EShotPerception Perception;
+	};
+}
+
+bool UShotEventSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const {
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+TStatId UShotEventSubsystem::GetStatId() const {
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UShotEventSubsystem, STATGROUP_Tickables);
+}
+
+bool UShotEventSubsystem::IsTickable() const {
+	return !Shots.IsEmpty();
+}
+
+void UShotEventSubsystem::Tick(float DeltaTime) {
+	Super::Tick(DeltaTime);
+
+	FlushShots();
+}
+
+void UShotEventSubsystem::QueueShot(ABlasterCharacter* Shooter, const FFireInput& Input) {
+	if (Shooter == nullptr) return;
+
+	FShotEvent& Shot = Shots.AddDefaulted_GetRef();
+	Shot.Shooter = Shooter;
+	Shot.Input = Input;
+}
+
+void UShotEventSubsystem::FlushShots() {
+	UWorld* World = GetWorld();
+	if (World == nullptr || World->GetNetMode() == NM_Client || World->GetNetMode() == NM_Standalone) {
+		Shots.Reset();
+		return;
+	}
+
+	for (FConstPlayerControllerIterator It = World->GetPlayerControllerIterator(); It; ++It) {
+		ABlasterPlayerController* Controller = Cast<ABlasterPlayerController>(It->Get());
+
+		// The server's own player saw the shots when the server fired them
+		if (Controller == nullptr || Controller->IsLocalController()) continue;
+
+		FVector ViewLocation;
+		FRotator ViewRotation;
+		Controller->GetPlayerViewPoint(ViewLocation, ViewRotation);
+		const AActor* ViewTarget = Controller->GetViewTarget();
+
+		// Automatic weapons fire several shots a frame, so each shooter is only
+		// judged once per connection. Only a handful of shooters fire in a
+		// frame, so a linear search beats a map.
+		TArray<FShooterPerception, TInlineAllocator<16>> Perceptions;
+
+		ConnectionShots.Reset();
+		ConnectionDistantShooters.Reset();
+		for (const FShotEvent& Shot : Shots) {
+			if (!IsValid(Shot.Shooter) || Shot.Shooter->Controller == Controller) continue;
+
+			const FShooterPerception* Cached = Perceptions.FindByPredicate([&Shot](const FShooterPerception& Entry) {
+				return Entry.Shooter == Shot.Shooter;
+			});
+			const EShotPerception Perception = Cached ? Cached->Perception :
+				Perceptions.Add_GetRef({ Shot.Shooter, GetPerception(Controller, ViewLocation, ViewTarget, Shot.Shooter) }).Perception;
+
+			if (Perception == EShotPerception::Full) {
+				ConnectionShots.Add(Shot);
+			} else if (Perception == EShotPerception::Distant) {
+				ConnectionDistantShooters.Add(Shot.Shooter);
+			}
+		}
+		if (!ConnectionShots.IsEmpty() || !ConnectionDistantShooters.IsEmpty()) {
+			Controller->ClientShotEvents(ConnectionShots, ConnectionDistantShooters);
+		}
+	}
+	Shots.Reset();
+}
+
+EShotPerception UShotEventSubsystem::GetPerception(const ABlasterPlayerController* Controller, const FVector& ViewLocation,
+	const AActor* ViewTarget, const ABlasterCharacter* Shooter) const {
+	// A shooter that isn't relevant doesn't exist on the client
+	if (!Shooter->IsNetRelevantFor(Controller, ViewTarget, ViewLocation)) {
+		return EShotPerception::None;
+	}
+
+	const double DistSquared = FVector::DistSquared(ViewLocation, Shooter->GetActorLocation());
+	if (DistSquared <= FMath::Square(NearEventDistance) ||
+		(DistSquared <= FMath::Square(FullEventDistance) && CanSee(ViewLocation, ViewTarget, Shooter))) {
+		return EShotPerception::Full;
+	}
+	if (DistSquared <= FMath::Square(AudibleDistance)) {
+		return EShotPerception::Distant;
+	}
+	return EShotPerception::None;
+}
+
+bool UShotEventSubsystem::CanSee(const FVector& ViewLocation, const AActor* ViewTarget,
+	const ABlasterCharacter* Shooter) const {
+	FCollisionQueryParams Params(SCENE_QUERY_STAT(ShotEventVisibility));
+	Params.AddIgnoredActor(ViewTarget);
+	Params.AddIgnoredActor(Shooter);
+	return !GetWorld()->LineTraceTestByChannel(ViewLocation, Shooter->GetPawnViewLocation(), ECC_Visibility, Params);
+}
@@ -0,0 +1,79 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Blaster/BlasterTypes/ShotEvent.h"
+#include "ShotEventSubsystem.generated.h"
+
+class ABlasterCharacter;
+class ABlasterPlayerController;
+
+/** How much of a shooter's shots one connection gets */
+enum class EShotPerception : uint8 {
+	None,
+	Full,
+	Distant
+};
+
+/**
+* Server-side channel for telling clients about shots. Every shot the server
+* fires in a frame is collected, then at the end of the frame each connection
+* gets one RPC with only the shots its player could perceive:
+*	- Close by, or in view within FullEventDistance: the whole shot, which the
+*	  client plays with montages, tracers and impacts
+*	- Further away but within AudibleDistance: just the shooter, which the
+*	  client plays as a distant fire sound
+*	- Anything else, or a shooter not relevant to the connection: nothing
+* The shooter's own client predicted its shots and isn't sent them.
+*/
+UCLASS(Config = Game)
+class BLASTER_API UShotEventSubsystem : public UTickableWorldSubsystem {
+	GENERATED_BODY()
+
+public:
+
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+	virtual bool IsTickable() const override;
+
+	/** Queues a shot the server has fired to be sent with the rest of the frame's */
+	void QueueShot(ABlasterCharacter* Shooter, const FFireInput& Input);
+
+	/** Sends everything queued so far */
+	void FlushShots();
+
+protected:
+
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+private:
+
+	EShotPerception GetPerception(const ABlasterPlayerController* Controller, const FVector& ViewLocation,
+		const AActor* ViewTarget, const ABlasterCharacter* Shooter) const;
+	bool CanSee(const FVector& ViewLocation, const AActor* ViewTarget, const ABlasterCharacter* Shooter) const;
+
+	UPROPERTY()
+	TArray<FShotEvent> Shots;
+
+	// Built for one connection at a time, kept so their storage is reused
+	UPROPERTY()
+	TArray<FShotEvent> ConnectionShots;
+
+	UPROPERTY()
+	TArray<ABlasterCharacter*> ConnectionDistantShooters;
+
+	// Within this distance whole shots are sent even without line of sight,
+	// since tracers and impacts can show round corners
+	UPROPERTY(Config)
+	float NearEventDistance = 1500.f;
+
+	// Within this distance whole shots are sent if the shooter is in view
+	UPROPERTY(Config)
+	float FullEventDistance = 5000.f;
+
+	// Beyond full events but within this distance shots are only heard
+	UPROPERTY(Config)
+	float AudibleDistance = 15000.f;
+};
@@ -0,0 +1,25 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "ShotNet.h"
+#include "WeaponTypes.h"
+
+uint32 ShotNet::CompressAim(const FVector& Direction) {
+	const FRotator Rotation = Direction.Rotation();
+	return (static_cast<uint32>(FRotator::CompressAxisToShort(Rotation.Pitch)) << 16) |
+		FRotator::CompressAxisToShort(Rotation.Yaw);
+}
+
+FVector ShotNet::DecompressAim(uint32 Aim) {
+	return FRotator(
+		FRotator::DecompressAxisFromShort(static_cast<uint16>(Aim >> 16)),
+		FRotator::DecompressAxisFromShort(static_cast<uint16>(Aim & 0xFFFF)),
+		0.0).Vector();
+}
+
+FVector ShotNet::GetAimTarget(const FVector& TraceStart, uint32 Aim) {
+	return TraceStart + DecompressAim(Aim) * TRACE_LENGTH;
+}
+
+int32 ShotNet::GetShotSeed(int32 OwnerSeed, uint16 Sequence) {
+	return static_cast<int32>(HashCombine(static_cast<uint32>(OwnerSeed), GetTypeHash(Sequence)));
+}
@@ -0,0 +1,34 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+* Shots as they are sent over the network. Rather than a world space end point,
+* a shot is sent as its aim direction packed into 32 bits and a sequence number
+* counted by the shooter. The sequence number and a seed the server gives each
+* shooter make the shot's random seed, so every machine applies the same
+* scatter without it being sent.
+*/
+namespace ShotNet {
+
+	/** Packs a direction into pitch and yaw of 16 bits each, about 1 cm off at 100 m */
+	uint32 CompressAim(const FVector& Direction);
+	FVector DecompressAim(uint32 Aim);
+
+	/** Unscattered end of a shot fired from TraceStart, TRACE_LENGTH away */
+	FVector GetAimTarget(const FVector& TraceStart, uint32 Aim);
+
+	/**
+	* @param  OwnerSeed The shooter's seed, from the server
+	* @param  Sequence The shot's sequence number
+	* @return Seed for the shot's scatter
+	*/
+	int32 GetShotSeed(int32 OwnerSeed, uint16 Sequence);
+
+	/** Whether sequence number A comes after B, allowing for wrap around */
+	FORCEINLINE bool IsNewerSequence(uint16 A, uint16 B) {
+		return static_cast<int16>(A - B) > 0;
+	}
+}
@@ -4,18 +4,36 @@
 
 #include "CoreMinimal.h"
 #include "HitScanWeapon.h"
+#include "Blaster/BlasterComponents/LagCompensationComponent.h"
 #include "Shotgun.generated.h"
 
 /**
- *
- */
+* Pellet spread comes from a random stream seeded per blast, so a blast goes
+* over the wire as just its muzzle, aim and sequence number. The firing
+* client, the server and every other client regenerate the same pellets from
+* those, see ShotNet.
+*/
 UCLASS()
 class BLASTER_API AShotgun : public AHitScanWeapon {
 	GENERATED_BODY()
 
 public:
-	virtual void FireShotgun(const TArray<FVector_NetQuantize>& HitTargets);
-	void ShotgunTraceEndWithScatter(const FVector& HitTarget, TArray<FVector_NetQuantize>& HitTargets);
+	virtual void FireShotgun(const FFireInput& Blast);
+
+	/**
+	* Where each pellet of a blast ends. Only depends on the arguments and the
+	* weapon's scatter settings, so it gives the same pellets on every machine.
+	*
+	* @param  TraceStart Muzzle location the blast was fired from
+	* @param  Aim The shooter's aim, see ShotNet::CompressAim
+	* @param  Seed The blast's random seed
+	* @param  OutHitTargets Receives one end location per pellet
+	*/
+	void ShotgunTraceEndWithScatter(const FVector& TraceStart, uint32 Aim, int32 Seed,
+		TArray<FVector_NetQuantize, TInlineAllocator<SHOTGUN_MAX_PELLETS>>& OutHitTargets) const;
+
+	/** Muzzle location, rounded the way FVector_NetQuantize is sent so it matches what others receive */
+	bool GetTraceStart(FVector_NetQuantize& OutTraceStart) const;
 
 
 private:
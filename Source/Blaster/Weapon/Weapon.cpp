@@ -87,7 +87,7 @@ void AWeapon::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeP
 	DOREPLIFETIME_CONDITION(AWeapon, bUseServerSideRewind, COND_OwnerOnly);
 }
 
-void AWeapon::Fire(const FVector& HitTarget) {
+void AWeapon::Fire(const FVector& HitTarget, uint16 ShotSequence) {
 	BlasterOwnerCharacter = BlasterOwnerCharacter == nullptr ? Cast<ABlasterCharacter>(GetOwner()) : BlasterOwnerCharacter;
 	if (FireAnimation) {
 		WeaponMesh->PlayAnimation(FireAnimation, false);
@@ -113,6 +113,20 @@ void AWeapon::Fire(const FVector& HitTarget) {
 	
 }
 
+void AWeapon::PlayDistantFireSound() {
+	if (DistantFireSound) {
+		UGameplayStatics::PlaySoundAtLocation(this, DistantFireSound, GetActorLocation());
+	}
+}
+
+// The server's ammo didn't change, so this is an acknowledgement that leaves
+// the client with the server's count minus its other unacknowledged rounds
+void AWeapon::RejectPredictedRound() {
+	if (HasAuthority()) {
+		ClientUpdateAmmo(Ammo);
+	}
+}
+
 void AWeapon::SetHUDAmmo() {
 	BlasterOwnerCharacter = BlasterOwnerCharacter == nullptr ? Cast<ABlasterCharacter>(GetOwner()) : BlasterOwnerCharacter;
 	if (BlasterOwnerCharacter) {
@@ -198,10 +212,6 @@ void AWeapon::OnWeaponStateSet() {
 	}
 }
 
-void AWeapon::OnPingTooHigh(bool bPingTooHigh) {
-	bUseServerSideRewind = !bPingTooHigh;
-}
-
 void AWeapon::OnRep_WeaponState() {
 	OnWeaponStateSet();
 }
@@ -221,15 +231,6 @@ void AWeapon::OnEquipped() {
 
 	BlasterOwnerCharacter = BlasterOwnerCharacter == nullptr ? 
 		Cast<ABlasterCharacter>(GetOwner()) : BlasterOwnerCharacter;
-
-	if (BlasterOwnerCharacter && bUseServerSideRewind) {
-		BlasterOwnerController = BlasterOwnerController == nullptr ? 
-			Cast<ABlasterPlayerController>(BlasterOwnerCharacter->Controller) : BlasterOwnerController;
-
-		if (BlasterOwnerController && HasAuthority() && !BlasterOwnerController->HighPingDelegate.IsBound()) {
-			BlasterOwnerController->HighPingDelegate.AddDynamic(this, &AWeapon::OnPingTooHigh);
-		}
-	}
 }
 
 void AWeapon::OnEquippedSecondary() {
@@ -251,15 +252,6 @@ void AWeapon::OnEquippedSecondary() {
 
 	BlasterOwnerCharacter = BlasterOwnerCharacter == nullptr ?
 		Cast<ABlasterCharacter>(GetOwner()) : BlasterOwnerCharacter;
-
-	if (BlasterOwnerCharacter && bUseServerSideRewind) {
-		BlasterOwnerController = BlasterOwnerController == nullptr ?
-			Cast<ABlasterPlayerController>(BlasterOwnerCharacter->Controller) : BlasterOwnerController;
-
-		if (BlasterOwnerController && HasAuthority() && BlasterOwnerController->HighPingDelegate.IsBound()) {
-			BlasterOwnerController->HighPingDelegate.RemoveDynamic(this, &AWeapon::OnPingTooHigh);
-		}
-	}
 }
 
 void AWeapon::OnDropped() {
@@ -283,15 +275,6 @@ void AWeapon::OnDropped() {
 
 	BlasterOwnerCharacter = BlasterOwnerCharacter == nullptr ?
 		Cast<ABlasterCharacter>(GetOwner()) : BlasterOwnerCharacter;
-
-	if (BlasterOwnerCharacter && bUseServerSideRewind) {
-		BlasterOwnerController = BlasterOwnerController == nullptr ?
-			Cast<ABlasterPlayerController>(BlasterOwnerCharacter->Controller) : BlasterOwnerController;
-
-		if (BlasterOwnerController && HasAuthority() && BlasterOwnerController->HighPingDelegate.IsBound()) {
-			BlasterOwnerController->HighPingDelegate.RemoveDynamic(this, &AWeapon::OnPingTooHigh);
-		}
-	}
 }
 
 void AWeapon::Dropped() {
@@ -330,15 +313,10 @@ void AWeapon::OnSphereEndOverlap(UPrimitiveComponent* OverlappedComponent, AActo
 	}
 }
 
-FVector AWeapon::TraceEndWithScatter(const FVector& HitTarget) {
-
-	const USkeletalMeshSocket* MuzzleFlashSocket = GetWeaponMesh()->GetSocketByName("MuzzleFlash");
-	if (MuzzleFlashSocket == nullptr) return FVector();
-	const FTransform SocketTransform = MuzzleFlashSocket->GetSocketTransform(GetWeaponMesh());
-	const FVector TraceStart = SocketTransform.GetLocation();
+FVector AWeapon::TraceEndWithScatter(const FVector& TraceStart, const FVector& HitTarget, FRandomStream& Stream) const {
 	const FVector ToTargetNormalized = (HitTarget - TraceStart).GetSafeNormal();
 	const FVector SphereCenter = TraceStart + ToTargetNormalized * DistanceToSphere;
-	const FVector RandomVector = UKismetMathLibrary::RandomUnitVector() * FMath::FRandRange(0.f, SphereRadius);
+	const FVector RandomVector = Stream.VRand() * Stream.FRandRange(0.f, SphereRadius);
 	const FVector EndLocation = SphereCenter + RandomVector;
 	const FVector ToEndLocation = EndLocation - TraceStart;
 
@@ -353,4 +331,11 @@ FVector AWeapon::TraceEndWithScatter(const FVector& HitTarget) {
 		true);
 	*/
 	return FVector(TraceStart + ToEndLocation * TRACE_LENGTH / ToEndLocation.Size());
+}
+
+bool AWeapon::GetMuzzleLocation(FVector& OutLocation) const {
+	const USkeletalMeshSocket* MuzzleFlashSocket = GetWeaponMesh()->GetSocketByName("MuzzleFlash");
+	if (MuzzleFlashSocket == nullptr) return false;
+	OutLocation = MuzzleFlashSocket->GetSocketTransform(GetWeaponMesh()).GetLocation();
+	return true;
 }
\ No newline at end of file
@@ -38,13 +38,21 @@ public:
 	virtual void OnRep_Owner() override;
 	void SetHUDAmmo();
 	void ShowPickupWidget(bool bShowWidget);
-	virtual void Fire(const FVector& HitTarget);
+	virtual void Fire(const FVector& HitTarget, uint16 ShotSequence);
 	bool IsEmpty();
 	bool IsFull();
 	void SetWeaponState(EWeaponState State);
 	virtual void Dropped();
 	void AddAmmo(int32 AmmoToAdd);
-	FVector TraceEndWithScatter(const FVector& HitTarget);
+
+	/**
+	* Scatters a shot within the weapon's scatter sphere. Draws from Stream
+	* rather than the global random, so a stream seeded the same way gives the
+	* same scatter on every machine.
+	*/
+	FVector TraceEndWithScatter(const FVector& TraceStart, const FVector& HitTarget, FRandomStream& Stream) const;
+
+	bool GetMuzzleLocation(FVector& OutLocation) const;
 
 	// Textures for the weapon crosshairs
 	UPROPERTY(EditAnywhere, Category = Crosshairs)
@@ -84,6 +92,18 @@ public:
 	UPROPERTY(EditAnywhere)
 	class USoundCue* EquipSound;
 
+	// Played instead of the whole shot for players too far away to see it
+	UPROPERTY(EditAnywhere)
+	USoundCue* DistantFireSound;
+
+	void PlayDistantFireSound();
+
+	/**
+	* Tells the owning client that a round it predicted spending was never
+	* fired, so its ammo count goes back to the server's. Server only.
+	*/
+	void RejectPredictedRound();
+
 	/**
 	* Enable or disable custom depth
 	*/
@@ -136,9 +156,6 @@ protected:
 	UPROPERTY()
 	class ABlasterPlayerController* BlasterOwnerController;
 
-	UFUNCTION()
-	void OnPingTooHigh(bool bPingTooHigh);
-
 
 private:
 	UPROPERTY(VisibleAnywhere, Category = "Weapon Properties")